@@ -0,0 +1,121 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using openocd.CmsisDap;
+using openocd.CmsisDap.Backend;
+using openocd.CoreSight;
+
+namespace VK_CMSIS_SVD_Test
+{
+    [TestClass]
+    public class DapSimulatedTest
+    {
+        private const UInt32 RAM_START = 0x20000000;
+        private const UInt32 RAM_SIZE = 0x40000;
+
+        private static AHB_AP connect(BackendSimulated backend)
+        {
+            backend.addMemory(RAM_START, RAM_SIZE);
+            DapAccessLink link = new DapAccessLink("SIMULATED", backend);
+            link.open();
+            link.set_clock(4000000);
+            link.connect();
+            link.swj_sequence();
+            DebugAccessPort dp = new DebugAccessPort(link);
+            dp.init();
+            dp.power_up_debug();
+            AHB_AP ap = new AHB_AP(dp, 0);
+            ap.init();
+            return ap;
+        }
+
+        private static List<UInt32> pattern(int count, UInt32 seed)
+        {
+            return Enumerable.Range(0, count).Select(i => unchecked((UInt32)i * 2654435761U + seed)).ToList();
+        }
+
+        // 
+        //         Write and read back through every packet size and count, the data
+        //         crosses several auto increment wraps of the AP
+        // 
+        [TestMethod]
+        [TestCategory("Benchmark")]
+        public void SweepPacketCountAndSize()
+        {
+            foreach (UInt32 ap_idr in new UInt32[] { 0x24770011, 0x64770001 })
+            {
+                foreach (UInt16 packet_size in new UInt16[] { 64, 512 })
+                {
+                    foreach (byte packet_count in new byte[] { 1, 2, 4, 8 })
+                    {
+                        BackendSimulated backend = new BackendSimulated(packet_size, packet_count, 1.0);
+                        backend.ap_idr = ap_idr;
+                        AHB_AP ap = connect(backend);
+                        // Start off a wrap boundary so every chunk is split
+                        UInt32 addr = RAM_START + 0xF00;
+                        List<UInt32> data = pattern(0x4000, packet_count);
+
+                        backend.resetStats();
+                        Stopwatch stopwatch = Stopwatch.StartNew();
+                        ap.writeBlockMemoryAligned32(addr, data);
+                        List<UInt32> readback = ap.readBlockMemoryAligned32(addr, (UInt32)data.Count);
+                        stopwatch.Stop();
+                        Console.WriteLine("IDR 0x{0:X8}, {1} x {2} B packets: {3} ms, {4} packets, {5:0} transfers/s",
+                            ap_idr, packet_count, packet_size, stopwatch.ElapsedMilliseconds, backend.packets, backend.getTransferRate());
+
+                        CollectionAssert.AreEqual(data, readback, String.Format("IDR 0x{0:X8}, {1} x {2} B packets", ap_idr, packet_count, packet_size));
+                    }
+                }
+            }
+        }
+
+        [TestMethod]
+        public void FaultDoesNotBreakLaterTransfers()
+        {
+            AHB_AP ap = connect(new BackendSimulated(64, 4, 0.1));
+            List<UInt32> data = pattern(0x100, 1);
+            ap.writeBlockMemoryAligned32(RAM_START, data);
+            try
+            {
+                ap.readBlockMemoryAligned32(RAM_START + RAM_SIZE, 0x10);
+                Assert.Fail("Read outside of RAM did not fault");
+            }
+            catch (AssertFailedException)
+            {
+                throw;
+            }
+            catch (Exception)
+            {
+            }
+            CollectionAssert.AreEqual(data, ap.readBlockMemoryAligned32(RAM_START, (UInt32)data.Count));
+        }
+
+        [TestMethod]
+        public void ReadFailureDoesNotShiftLaterResponses()
+        {
+            BackendSimulated backend = new BackendSimulated(64, 4, 0.1);
+            AHB_AP ap = connect(backend);
+            List<UInt32> data = pattern(0x400, 2);
+            ap.writeBlockMemoryAligned32(RAM_START, data);
+            // Fail a read in the middle of a block read, with more packets queued behind it
+            backend.fail_read = 2;
+            try
+            {
+                ap.readBlockMemoryAligned32(RAM_START, (UInt32)data.Count);
+                Assert.Fail("Read did not fail");
+            }
+            catch (AssertFailedException)
+            {
+                throw;
+            }
+            catch (Exception error)
+            {
+                Assert.IsInstanceOfType(error.InnerException, typeof(DeviceError));
+            }
+            CollectionAssert.AreEqual(data, ap.readBlockMemoryAligned32(RAM_START, (UInt32)data.Count));
+            Assert.AreEqual(data[0x10], ap.read32(RAM_START + 0x40)());
+        }
+    }
+}
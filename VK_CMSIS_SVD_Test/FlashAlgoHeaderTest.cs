@@ -0,0 +1,181 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using openocd.Flash;
+
+namespace VK_CMSIS_SVD_Test
+{
+    [TestClass]
+    public class FlashAlgoHeaderTest
+    {
+        private const UInt32 LOAD_ADDRESS = 0x20000000;
+
+        // Header followed by a few words of code, laid out like Targets/FlashAlgo.h
+        private static List<UInt32> syntheticImage(UInt32 caps)
+        {
+            return new List<UInt32>
+            {
+                0xE00ABE00,                     // trap
+                FlashAlgoHeader.ALGO_MAGIC,
+                FlashAlgoHeader.ALGO_VERSION,
+                11 * 4,                         // header size
+                caps,
+                0x00000041,                     // dispatch
+                0x00000400,                     // static_base
+                0x00001000,                     // stack
+                0x00001000,                     // data
+                0x00000200,                     // data_size
+                0x00002000,                     // ram_size
+                0x47702000, 0x47702000, 0x47702000,
+            };
+        }
+
+        private static Dictionary<string, object> syntheticAlgo(UInt32 caps)
+        {
+            return new Dictionary<string, object>
+            {
+                { "load_address", LOAD_ADDRESS },
+                { "instructions", syntheticImage(caps) },
+                { "min_program_length", (UInt32)256 },
+            };
+        }
+
+        // Records the registers of the last call instead of running it on a core
+        private class RecordingFlash : openocd.Flash.Flash
+        {
+            public UInt32 pc;
+            public UInt32? r0, r1, r2, r3;
+            public List<byte> page;
+
+            public RecordingFlash(Dictionary<string, object> flash_algo) : base(null, flash_algo)
+            {
+            }
+
+            public override void callFunction(UInt32 pc, UInt32? r0 = null, UInt32? r1 = null, UInt32? r2 = null, UInt32? r3 = null, bool init = false)
+            {
+                this.pc = pc;
+                this.r0 = r0;
+                this.r1 = r1;
+                this.r2 = r2;
+                this.r3 = r3;
+            }
+
+            public override void programPage(UInt32 flashPtr, List<byte> bytes)
+            {
+                this.r0 = flashPtr;
+                this.page = bytes;
+            }
+        }
+
+        [TestMethod]
+        public void ParseSyntheticHeader()
+        {
+            UInt32 caps = FlashAlgoHeader.ALGO_CAP_ERASE_SECTOR | FlashAlgoHeader.ALGO_CAP_PROGRAM_PAGE | FlashAlgoHeader.ALGO_CAP_STATS;
+            FlashAlgoHeader header = FlashAlgoHeader.parse(syntheticImage(caps));
+            Assert.IsNotNull(header);
+            Assert.AreEqual(FlashAlgoHeader.ALGO_VERSION, header.version);
+            Assert.AreEqual(caps, header.caps);
+            Assert.AreEqual(0x00000041U, header.dispatch);
+            Assert.AreEqual(0x00000400U, header.static_base);
+            Assert.AreEqual(0x00001000U, header.stack);
+            Assert.AreEqual(0x00001000U, header.data);
+            Assert.AreEqual(0x00000200U, header.data_size);
+            Assert.AreEqual(0x00002000U, header.ram_size);
+            Assert.IsTrue(header.hasCapability(FlashAlgoHeader.ALGO_CAP_STATS));
+            Assert.IsFalse(header.hasCapability(FlashAlgoHeader.ALGO_CAP_ERASE_CHIP));
+        }
+
+        [TestMethod]
+        public void ParseWithoutMagicReturnsNull()
+        {
+            List<UInt32> image = syntheticImage(0);
+            image[1] = 0;
+            Assert.IsNull(FlashAlgoHeader.parse(image));
+            Assert.IsNull(FlashAlgoHeader.parse(new List<UInt32> { 0xE00ABE00, FlashAlgoHeader.ALGO_MAGIC }));
+        }
+
+        private static string parseError(List<UInt32> image)
+        {
+            try
+            {
+                FlashAlgoHeader.parse(image);
+            }
+            catch (Exception e)
+            {
+                return e.Message;
+            }
+            return null;
+        }
+
+        [TestMethod]
+        public void ParseRejectsOtherVersionAndTruncatedHeader()
+        {
+            List<UInt32> image = syntheticImage(0);
+            image[2] = FlashAlgoHeader.ALGO_VERSION + 1;
+            Assert.AreEqual("Unsupported flash algorithm header version 2", parseError(image));
+
+            image = syntheticImage(0);
+            image[3] = 8 * 4;
+            Assert.AreEqual("Truncated flash algorithm header of 32 bytes", parseError(image));
+        }
+
+        [TestMethod]
+        public void SupportsFollowsCapabilities()
+        {
+            FlashAlgoHeader header = FlashAlgoHeader.parse(syntheticImage(FlashAlgoHeader.ALGO_CAP_ERASE_SECTOR | FlashAlgoHeader.ALGO_CAP_PROGRAM_PAGE));
+            Assert.IsTrue(header.supports("pc_init"));
+            Assert.IsTrue(header.supports("pc_uninit"));
+            Assert.IsTrue(header.supports("pc_erase_sector"));
+            Assert.IsTrue(header.supports("pc_program_page"));
+            Assert.IsFalse(header.supports("pc_eraseAll"));
+            Assert.IsFalse(header.supports("pc_program_fill"));
+            Assert.IsFalse(header.supports("analyzer_address"));
+            Assert.IsFalse(header.supports("pc_unknown"));
+        }
+
+        [TestMethod]
+        public void CallAlgoUsesDispatchEntry()
+        {
+            RecordingFlash flash = new RecordingFlash(syntheticAlgo(FlashAlgoHeader.ALGO_CAP_ERASE_SECTOR | FlashAlgoHeader.ALGO_CAP_PROGRAM_PAGE));
+
+            flash.callAlgo("pc_erase_sector", 0x08020000);
+            Assert.AreEqual(LOAD_ADDRESS + 0x41, flash.pc);
+            Assert.AreEqual((UInt32?)0x08020000, flash.r0);
+            Assert.AreEqual((UInt32?)FlashAlgoHeader.ALGO_OP_ERASE_SECTOR, flash.r3);
+
+            flash.callAlgo("pc_program_page", 0x08000000, 256, LOAD_ADDRESS + 0x1000);
+            Assert.AreEqual(LOAD_ADDRESS + 0x41, flash.pc);
+            Assert.AreEqual((UInt32?)256, flash.r1);
+            Assert.AreEqual((UInt32?)(LOAD_ADDRESS + 0x1000), flash.r2);
+            Assert.AreEqual((UInt32?)FlashAlgoHeader.ALGO_OP_PROGRAM_PAGE, flash.r3);
+        }
+
+        [TestMethod]
+        public void ProgramFillWithoutEntryPointProgramsPattern()
+        {
+            RecordingFlash flash = new RecordingFlash(syntheticAlgo(FlashAlgoHeader.ALGO_CAP_PROGRAM_PAGE));
+            flash.programFill(0x08000100, 8, 0xA5C3F00F);
+            Assert.AreEqual((UInt32?)0x08000100, flash.r0);
+            CollectionAssert.AreEqual(new List<byte> { 0x0F, 0xF0, 0xC3, 0xA5, 0x0F, 0xF0, 0xC3, 0xA5 }, flash.page);
+        }
+
+        [TestMethod]
+        public void PartialPageFollowsCapability()
+        {
+            Assert.IsFalse(new RecordingFlash(syntheticAlgo(FlashAlgoHeader.ALGO_CAP_PROGRAM_PAGE)).isPartialPageSupported());
+            Assert.IsTrue(new RecordingFlash(syntheticAlgo(FlashAlgoHeader.ALGO_CAP_PROGRAM_PAGE | FlashAlgoHeader.ALGO_CAP_PARTIAL_PAGE)).isPartialPageSupported());
+        }
+
+        [TestMethod]
+        public void StripErasedTailKeepsProgramUnit()
+        {
+            List<byte> page = new List<byte>(new byte[] { 1, 2, 3, 4, 5 });
+            page.AddRange(new byte[27].Select(b => (byte)0xFF));
+            Assert.AreEqual(8, FlashBuilderConsts._strip_erased_tail(page, 4).Count);
+            Assert.AreEqual(16, FlashBuilderConsts._strip_erased_tail(page, 16).Count);
+            Assert.AreEqual(32, FlashBuilderConsts._strip_erased_tail(page, 256).Count);
+            Assert.AreEqual(0, FlashBuilderConsts._strip_erased_tail(page.Skip(8).ToList(), 4).Count);
+        }
+    }
+}
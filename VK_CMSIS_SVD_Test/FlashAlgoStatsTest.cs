@@ -0,0 +1,99 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using System.Threading;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using openocd.Flash;
+
+namespace VK_CMSIS_SVD_Test
+{
+    [TestClass]
+    public class FlashAlgoStatsTest
+    {
+        private static List<UInt32> statsBlock(UInt32 version)
+        {
+            List<UInt32> words = Enumerable.Repeat<UInt32>(0, FlashAlgoStats.WORD_COUNT).ToList();
+            words[0] = version;
+            // erase_sector: 2 calls, 10 polls, 32 KB, 48000 cycles max, 80000 cycles total
+            int index = FlashAlgoStats.HEADER_WORDS + 1 * FlashAlgoStats.OP_WORDS;
+            words[index + 0] = 2;
+            words[index + 2] = 10;
+            words[index + 3] = 0x8000;
+            words[index + 4] = 48000;
+            words[index + 5] = 80000;
+            return words;
+        }
+
+        [TestMethod]
+        public void ParseStatsBlock()
+        {
+            FlashAlgoStats stats = FlashAlgoStats.parse(statsBlock(FlashAlgoStats.ALGO_STATS_VERSION));
+            Assert.IsNotNull(stats);
+            Assert.AreEqual(2U, stats.erase_sector.calls);
+            Assert.AreEqual(10U, stats.erase_sector.polls);
+            Assert.AreEqual(80000UL, stats.erase_sector.cycles);
+            Assert.AreEqual(0.0025, stats.erase_sector.getMeanLatency(16000000));
+            Assert.AreEqual(0U, stats.program_page.calls);
+        }
+
+        [TestMethod]
+        public void ParseUnknownVersionReturnsNull()
+        {
+            Assert.IsNull(FlashAlgoStats.parse(statsBlock(FlashAlgoStats.ALGO_STATS_VERSION + 1)));
+            Assert.IsNull(FlashAlgoStats.parse(new List<UInt32> { FlashAlgoStats.ALGO_STATS_VERSION }));
+        }
+
+        // Legacy image without header or cpu_clock whose calls take a fixed time
+        private class TimedFlash : openocd.Flash.Flash
+        {
+            public int call_ms;
+
+            public TimedFlash() : base(null, new Dictionary<string, object>
+                {
+                    { "load_address", (UInt32)0x20000000 },
+                    { "instructions", new List<UInt32> { 0xE00ABE00, 0x47702000 } },
+                    { "pc_erase_sector", (UInt32)0x20000001 },
+                    { "pc_program_page", (UInt32)0x20000001 },
+                    { "begin_stack", (UInt32)0x20001000 },
+                    { "begin_data", (UInt32)0x20001000 },
+                    { "static_base", (UInt32)0x20000400 },
+                    { "analyzer_supported", false },
+                })
+            {
+            }
+
+            public override FlashDevice getFlashDevice()
+            {
+                return new FlashDevice("Test", 0x08000000, 0x10000, 0x100, 0xFF, new List<FlashDevice.Sector> { new FlashDevice.Sector(0, 0x4000) });
+            }
+
+            public override UInt32 callAlgoAndWait(string pc_key, UInt32? r0 = null, UInt32? r1 = null, UInt32? r2 = null, bool init = false)
+            {
+                Thread.Sleep(this.call_ms);
+                return 0;
+            }
+        }
+
+        [TestMethod]
+        public void CalibrateWithoutClockUsesHostTimings()
+        {
+            TimedFlash flash = new TimedFlash();
+            double default_weight = flash.getSectorEraseWeight(0x4000);
+            flash.call_ms = 40;
+            flash.erasePage(0x08000000);
+            flash.erasePage(0x08004000);
+            flash.calibrate(null);
+
+            // 40 ms per 16 KB sector, scaled to the size asked for
+            double sector_weight = flash.getSectorEraseWeight(0x4000);
+            Assert.AreNotEqual(default_weight, sector_weight);
+            Assert.IsTrue(sector_weight >= 0.035 && sector_weight < 0.5, sector_weight.ToString());
+            Assert.AreEqual(sector_weight / 4, flash.getSectorEraseWeight(0x1000), 1e-9);
+
+            // Counters start over after each calibration
+            flash.call_ms = 0;
+            flash.calibrate(null);
+            Assert.AreEqual(sector_weight, flash.getSectorEraseWeight(0x4000));
+        }
+    }
+}
@@ -0,0 +1,237 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using openocd.Core;
+using openocd.Flash;
+
+namespace VK_CMSIS_SVD_Test
+{
+    [TestClass]
+    public class FlashBuilderTest
+    {
+        private const UInt32 FLASH_START = 0x08000000;
+        private const UInt32 OPTION_START = 0x1FFF0000;
+        private const UInt32 OPTION_SIZE = 0x20;
+
+        // Flash banks in memory, only block reads are supported
+        private class MemoryTarget : Target
+        {
+            public readonly Dictionary<UInt32, byte[]> banks = new Dictionary<UInt32, byte[]>();
+            public long read_bytes;
+
+            public MemoryTarget(UInt32 flash_size, UInt32 page_size) : base(null, new Memory.MemoryMap(
+                new Memory.FlashRegion(start: FLASH_START, length: flash_size, blocksize: page_size, isBootMemory: true),
+                new Memory.FlashRegion(start: OPTION_START, length: OPTION_SIZE, blocksize: OPTION_SIZE)))
+            {
+                this.banks[FLASH_START] = Enumerable.Repeat<byte>(0xFF, (int)flash_size).ToArray();
+                this.banks[OPTION_START] = Enumerable.Repeat<byte>(0xFF, (int)OPTION_SIZE).ToArray();
+            }
+
+            public byte[] bank(UInt32 addr, out int offset)
+            {
+                UInt32 start = this.banks.Keys.Single(bank_start => addr >= bank_start && addr < bank_start + this.banks[bank_start].Length);
+                offset = (int)(addr - start);
+                return this.banks[start];
+            }
+
+            public override List<byte> readBlockMemoryUnaligned8(UInt32 addr, UInt32 size)
+            {
+                int offset;
+                byte[] contents = this.bank(addr, out offset);
+                this.read_bytes += size;
+                return new ArraySegment<byte>(contents, offset, (int)size).ToList();
+            }
+
+            public override void resetStopOnReset(bool? software_reset = null) { }
+            public override void init(bool bus_accessible = true) { throw new NotSupportedException(); }
+            public override object info(object request) { throw new NotSupportedException(); }
+            public override UInt32 readIDCode() { throw new NotSupportedException(); }
+            public override void halt() { throw new NotSupportedException(); }
+            public override void step(bool disable_interrupts = true) { throw new NotSupportedException(); }
+            public override void resume() { throw new NotSupportedException(); }
+            public override bool massErase() { throw new NotSupportedException(); }
+            public override void writeMemory(UInt32 addr, UInt32 value, byte transfer_size = 32) { throw new NotSupportedException(); }
+            public override Func<UInt32> readMemory(UInt32 addr, byte transfer_size = 32, bool now = true) { throw new NotSupportedException(); }
+            public override void writeBlockMemoryUnaligned8(UInt32 addr, List<byte> data) { throw new NotSupportedException(); }
+            public override void writeBlockMemoryAligned32(UInt32 addr, List<UInt32> data) { throw new NotSupportedException(); }
+            public override List<UInt32> readBlockMemoryAligned32(UInt32 addr, UInt32 size) { throw new NotSupportedException(); }
+            public override UInt32 readCoreRegister(string id) { throw new NotSupportedException(); }
+            public override void writeCoreRegister(string id, UInt32 data) { throw new NotSupportedException(); }
+            public override UInt32 readCoreRegisterRaw(string reg) { throw new NotSupportedException(); }
+            public override List<UInt32> readCoreRegistersRaw(List<string> reg_list) { throw new NotSupportedException(); }
+            public override void writeCoreRegisterRaw(string reg, UInt32 data) { throw new NotSupportedException(); }
+            public override void writeCoreRegistersRaw(List<string> reg_list_s, List<UInt32> data_list) { throw new NotSupportedException(); }
+            public override openocd.Debugger.Breakpoints.Provider.Breakpoint findBreakpoint(UInt32 addr) { throw new NotSupportedException(); }
+            public override bool setBreakpoint(UInt32 addr, EBreakpointType type = EBreakpointType.BREAKPOINT_AUTO) { throw new NotSupportedException(); }
+            public override byte getBreakpointType(UInt32 addr) { throw new NotSupportedException(); }
+            public override void removeBreakpoint(UInt32 addr) { throw new NotSupportedException(); }
+            public override bool setWatchpoint(UInt32 addr, byte size, byte type) { throw new NotSupportedException(); }
+            public override void removeWatchpoint(UInt32 addr, byte size, byte type) { throw new NotSupportedException(); }
+            public override void reset(bool? software_reset = null) { throw new NotSupportedException(); }
+            public override void setTargetState(ETargetState state) { throw new NotSupportedException(); }
+            public override ETargetState getState() { throw new NotSupportedException(); }
+            public override int run_token { get { throw new NotSupportedException(); } }
+            public override void setVectorCatch(UInt32 enableMask) { throw new NotSupportedException(); }
+            public override UInt32 getVectorCatch() { throw new NotSupportedException(); }
+            public override string getTargetXML() { throw new NotSupportedException(); }
+            public override object getTargetContext(byte? core = null) { throw new NotSupportedException(); }
+            public override object getRootContext(object core = null) { throw new NotSupportedException(); }
+            public override void setRootContext(object context, object core = null) { throw new NotSupportedException(); }
+        }
+
+        // NOR flash algorithm working on a MemoryTarget, erase sets bytes to empty and program can only clear bits
+        private class MemoryFlash : openocd.Flash.Flash
+        {
+            private readonly MemoryTarget memory;
+            private readonly FlashDevice device;
+            public int erases;
+            public int programs;
+
+            public MemoryFlash(MemoryTarget target, FlashDevice device) : base(target, null)
+            {
+                this.memory = target;
+                this.device = device;
+            }
+
+            public override FlashDevice getFlashDevice()
+            {
+                return this.device;
+            }
+
+            public override bool isProgramFillSupported()
+            {
+                return false;
+            }
+
+            public override void init()
+            {
+            }
+
+            public override void eraseAll()
+            {
+                this.erases += 1;
+                this.erase(this.device.dev_adr, this.device.sz_dev);
+            }
+
+            public override void erasePage(UInt32 flashPtr)
+            {
+                this.erases += 1;
+                FlashDevice.Sector sector = this.device.getSector(flashPtr);
+                if (sector != null)
+                {
+                    this.erase(sector.addr, sector.size);
+                }
+                else
+                {
+                    // Only the option bytes are outside of the device
+                    this.erase(OPTION_START, OPTION_SIZE);
+                }
+            }
+
+            public override void programPage(UInt32 flashPtr, List<byte> bytes)
+            {
+                this.programs += 1;
+                int offset;
+                byte[] contents = this.memory.bank(flashPtr, out offset);
+                for (int i = 0; i < bytes.Count; i++)
+                {
+                    contents[offset + i] &= bytes[i];
+                }
+            }
+
+            private void erase(UInt32 addr, UInt32 size)
+            {
+                int offset;
+                byte[] contents = this.memory.bank(addr, out offset);
+                for (int i = 0; i < size; i++)
+                {
+                    contents[offset + i] = 0xFF;
+                }
+            }
+        }
+
+        private static byte[] pattern(int size, int seed)
+        {
+            byte[] data = new byte[size];
+            for (int i = 0; i < size; i++)
+            {
+                data[i] = (byte)((i * 7 + seed) & 0x7F);
+            }
+            return data;
+        }
+
+        [TestMethod]
+        public void ProgramsDataOutsideDeviceByPage()
+        {
+            // Four 1 KB sectors of 256 byte pages, option bytes outside of the device
+            FlashDevice device = new FlashDevice("Test", FLASH_START, 0x1000, 0x100, 0xFF, new List<FlashDevice.Sector> { new FlashDevice.Sector(0, 0x400) });
+            MemoryTarget target = new MemoryTarget(0x1000, 0x100);
+            MemoryFlash flash = new MemoryFlash(target, device);
+            byte[] image = pattern(0x600, 1);
+            byte[] options = pattern((int)OPTION_SIZE, 2);
+
+            FlashBuilder builder = new FlashBuilder(flash, FLASH_START);
+            builder.addData(FLASH_START + 0x200, new ArraySegment<byte>(image));
+            builder.addData(OPTION_START, options.ToList());
+            builder.program(chip_erase: false);
+
+            CollectionAssert.AreEqual(image, target.banks[FLASH_START].Skip(0x200).Take(image.Length).ToArray());
+            Assert.IsTrue(target.banks[FLASH_START].Take(0x200).All(b => b == 0xFF));
+            CollectionAssert.AreEqual(options, target.banks[OPTION_START]);
+            // Two sectors and the option page, 6 pages of image data and the option page
+            Assert.AreEqual(3, flash.erases);
+            Assert.AreEqual(7, flash.programs);
+        }
+
+        [TestMethod]
+        public void ChipEraseProgramsPlanWithoutReads()
+        {
+            FlashDevice device = new FlashDevice("Test", FLASH_START, 0x1000, 0x100, 0xFF, new List<FlashDevice.Sector> { new FlashDevice.Sector(0, 0x400) });
+            MemoryTarget target = new MemoryTarget(0x1000, 0x100);
+            MemoryFlash flash = new MemoryFlash(target, device);
+            byte[] image = pattern(0x1000, 3);
+
+            FlashBuilder builder = new FlashBuilder(flash, FLASH_START);
+            builder.addData(FLASH_START, new ArraySegment<byte>(image));
+            builder.program(chip_erase: true);
+
+            CollectionAssert.AreEqual(image, target.banks[FLASH_START]);
+            Assert.AreEqual(1, flash.erases);
+            Assert.AreEqual(0x1000 / 0x100, flash.programs);
+            Assert.AreEqual(0, target.read_bytes);
+        }
+
+        [TestMethod]
+        [TestCategory("Benchmark")]
+        public void ProgramLargeImage()
+        {
+            // 16 MB of 4 KB sectors, one in four differs
+            const int size = 16 << 20;
+            FlashDevice device = new FlashDevice("Bench", FLASH_START, size, 0x200, 0xFF, new List<FlashDevice.Sector> { new FlashDevice.Sector(0, 0x1000) });
+            MemoryTarget target = new MemoryTarget(size, 0x200);
+            MemoryFlash flash = new MemoryFlash(target, device);
+            byte[] image = pattern(size, 1);
+            Buffer.BlockCopy(image, 0, target.banks[FLASH_START], 0, size);
+            image = (byte[])image.Clone();
+            for (int offset = 0; offset < size; offset += 4 * 0x1000)
+            {
+                image[offset + 0x123] ^= 0x01;
+            }
+
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            FlashBuilder builder = new FlashBuilder(flash, FLASH_START);
+            builder.addData(FLASH_START, new ArraySegment<byte>(image));
+            builder.program(chip_erase: false);
+            stopwatch.Stop();
+            Console.WriteLine("Programmed {0} MB in {1} ms", size >> 20, stopwatch.ElapsedMilliseconds);
+
+            Assert.AreEqual(size / 0x4000, flash.erases);
+            Assert.AreEqual(size / 0x4000 * (0x1000 / 0x200), flash.programs);
+            // Each sector is read once to compare it
+            Assert.AreEqual(size, target.read_bytes);
+            CollectionAssert.AreEqual(image, target.banks[FLASH_START]);
+        }
+    }
+}
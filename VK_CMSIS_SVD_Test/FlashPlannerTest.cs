@@ -0,0 +1,233 @@
+using System;
+using System.Collections.Generic;
+using System.Linq;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using openocd.Flash;
+using openocd.Targets;
+
+namespace VK_CMSIS_SVD_Test
+{
+    [TestClass]
+    public class FlashPlannerTest
+    {
+        private const UInt32 FLASH_START = 0x08000000;
+
+        // Four 1 KB sectors of 256 byte pages
+        private static FlashDevice smallDevice()
+        {
+            return new FlashDevice("Test", FLASH_START, 0x1000, 0x100, 0xFF, new List<FlashDevice.Sector> { new FlashDevice.Sector(0, 0x400) });
+        }
+
+        // NOR flash contents, erase sets bytes to empty and program can only clear bits
+        private class FlashMemory
+        {
+            public readonly FlashDevice device;
+            public readonly byte[] contents;
+            public int reads;
+
+            public FlashMemory(FlashDevice device)
+            {
+                this.device = device;
+                this.contents = Enumerable.Repeat(device.val_empty, (int)device.sz_dev).ToArray();
+            }
+
+            public byte[] read(UInt32 addr, UInt32 size)
+            {
+                this.reads += 1;
+                byte[] data = new byte[size];
+                Buffer.BlockCopy(this.contents, (int)(addr - this.device.dev_adr), data, 0, (int)size);
+                return data;
+            }
+
+            public void write(UInt32 addr, byte[] data)
+            {
+                Buffer.BlockCopy(data, 0, this.contents, (int)(addr - this.device.dev_adr), data.Length);
+            }
+
+            public void apply(List<FlashPlanner.SectorPlan> plans)
+            {
+                foreach (FlashPlanner.SectorPlan sector_plan in plans)
+                {
+                    int sector_offset = (int)(sector_plan.sector.addr - this.device.dev_adr);
+                    if (sector_plan.action == FlashPlanner.SectorAction.ERASE_PROGRAM)
+                    {
+                        for (int i = 0; i < sector_plan.sector.size; i++)
+                        {
+                            this.contents[sector_offset + i] = this.device.val_empty;
+                        }
+                    }
+                    foreach (FlashPlanner.PagePlan page in sector_plan.pages)
+                    {
+                        int page_offset = (int)(page.addr - this.device.dev_adr);
+                        for (int i = 0; i < page.data.Count; i++)
+                        {
+                            this.contents[page_offset + i] &= page.data.Array[page.data.Offset + i];
+                        }
+                    }
+                }
+            }
+        }
+
+        private static byte[] pattern(int size, int seed)
+        {
+            byte[] data = new byte[size];
+            for (int i = 0; i < size; i++)
+            {
+                data[i] = (byte)((i * 7 + seed) & 0x7F);
+            }
+            return data;
+        }
+
+        private static void assertSector(FlashDevice device, UInt32 addr, UInt32 sector_addr, UInt32 sector_size)
+        {
+            FlashDevice.Sector sector = device.getSector(addr);
+            Assert.IsNotNull(sector, String.Format("0x{0:X8}", addr));
+            Assert.AreEqual(sector_addr, sector.addr, String.Format("0x{0:X8}", addr));
+            Assert.AreEqual(sector_size, sector.size, String.Format("0x{0:X8}", addr));
+        }
+
+        [TestMethod]
+        public void GetSectorAtGroupBoundaries()
+        {
+            // 4 x 32 KB, 1 x 128 KB, 3 x 256 KB as described in the shipped algorithm
+            FlashDevice device = FlashDevice.find((List<UInt32>)Target_STM32F7x_1024.flash_algo()["instructions"]);
+            Assert.IsNotNull(device);
+            Assert.AreEqual(FLASH_START, device.dev_adr);
+            Assert.AreEqual(0x100000U, device.sz_dev);
+            assertSector(device, 0x08000000, 0x08000000, 0x8000);
+            assertSector(device, 0x08007FFF, 0x08000000, 0x8000);
+            assertSector(device, 0x08008000, 0x08008000, 0x8000);
+            assertSector(device, 0x0801FFFF, 0x08018000, 0x8000);
+            assertSector(device, 0x08020000, 0x08020000, 0x20000);
+            assertSector(device, 0x0803FFFF, 0x08020000, 0x20000);
+            assertSector(device, 0x08040000, 0x08040000, 0x40000);
+            assertSector(device, 0x0807FFFF, 0x08040000, 0x40000);
+            assertSector(device, 0x08080000, 0x08080000, 0x40000);
+            assertSector(device, 0x080FFFFF, 0x080C0000, 0x40000);
+            Assert.IsNull(device.getSector(0x07FFFFFF));
+            Assert.IsNull(device.getSector(0x08100000));
+        }
+
+        [TestMethod]
+        public void AddDataOutsideDeviceIsRefused()
+        {
+            FlashPlanner planner = new FlashPlanner(smallDevice());
+            Assert.IsFalse(planner.addData(0x1FFF0000, pattern(0x10, 1)));
+            Assert.IsFalse(planner.addData(FLASH_START + 0xFF0, pattern(0x20, 1)));
+            Assert.IsTrue(planner.addData(FLASH_START + 0xFE0, pattern(0x20, 1)));
+            Assert.AreEqual(1, planner.getSectors().Count);
+        }
+
+        [TestMethod]
+        public void PlanActions()
+        {
+            FlashDevice device = smallDevice();
+            FlashMemory memory = new FlashMemory(device);
+            byte[] programmed = pattern(0x400, 1);
+            memory.write(FLASH_START, programmed);
+            memory.write(FLASH_START + 0x400, pattern(0x200, 2));
+            memory.write(FLASH_START + 0x800, pattern(0x400, 3));
+
+            FlashPlanner planner = new FlashPlanner(device);
+            // Same contents
+            planner.addData(FLASH_START, (byte[])programmed.Clone());
+            // Second half of the sector is still erased
+            planner.addData(FLASH_START + 0x600, pattern(0x100, 4));
+            // Programmed bytes change
+            planner.addData(FLASH_START + 0x900, pattern(0x10, 5));
+            List<FlashPlanner.SectorPlan> plans = planner.plan(memory.read);
+
+            Assert.AreEqual(3, plans.Count);
+            Assert.AreEqual(FlashPlanner.SectorAction.SKIP, plans[0].action);
+            Assert.AreEqual(0, plans[0].pages.Count);
+            Assert.AreEqual(FlashPlanner.SectorAction.PROGRAM, plans[1].action);
+            Assert.AreEqual(1, plans[1].pages.Count);
+            Assert.AreEqual(FLASH_START + 0x600, plans[1].pages[0].addr);
+            Assert.AreEqual(FlashPlanner.SectorAction.ERASE_PROGRAM, plans[2].action);
+            Assert.AreEqual(4, plans[2].pages.Count);
+        }
+
+        [TestMethod]
+        public void PlanWithoutPartialPagesErasesChangedSectors()
+        {
+            FlashDevice device = smallDevice();
+            FlashMemory memory = new FlashMemory(device);
+            memory.write(FLASH_START, pattern(0x200, 1));
+
+            // Only erased bytes change, but the algorithm programs whole pages
+            FlashPlanner planner = new FlashPlanner(device, partial_page: false);
+            planner.addData(FLASH_START + 0x200, pattern(0x100, 2));
+            List<FlashPlanner.SectorPlan> plans = planner.plan(memory.read);
+            Assert.AreEqual(FlashPlanner.SectorAction.ERASE_PROGRAM, plans[0].action);
+        }
+
+        [TestMethod]
+        public void PlanWithoutSmartErasesEverySector()
+        {
+            FlashDevice device = smallDevice();
+            FlashMemory memory = new FlashMemory(device);
+            byte[] programmed = pattern(0x400, 1);
+            memory.write(FLASH_START, programmed);
+
+            FlashPlanner planner = new FlashPlanner(device);
+            planner.addData(FLASH_START, (byte[])programmed.Clone());
+            planner.addData(FLASH_START + 0x800, pattern(0x10, 2));
+            List<FlashPlanner.SectorPlan> plans = planner.plan(memory.read, smart: false);
+
+            Assert.AreEqual(2, plans.Count);
+            Assert.IsTrue(plans.All(sector_plan => sector_plan.action == FlashPlanner.SectorAction.ERASE_PROGRAM));
+            // Only the partly covered sector is read
+            Assert.AreEqual(1, memory.reads);
+            memory.apply(plans);
+            CollectionAssert.AreEqual(programmed, memory.read(FLASH_START, 0x400));
+        }
+
+        [TestMethod]
+        public void EraseKeepsBytesOutsideImage()
+        {
+            foreach (bool smart in new[] { true, false })
+            {
+                FlashDevice device = smallDevice();
+                FlashMemory memory = new FlashMemory(device);
+                byte[] before = pattern(0x1000, 1);
+                memory.write(FLASH_START, before);
+
+                // Overwrites programmed bytes in the middle of sector 1
+                byte[] image = pattern(0x80, 9);
+                FlashPlanner planner = new FlashPlanner(device);
+                planner.addData(FLASH_START + 0x520, image);
+                List<FlashPlanner.SectorPlan> plans = planner.plan(memory.read, smart: smart);
+                Assert.AreEqual(1, plans.Count);
+                Assert.AreEqual(FlashPlanner.SectorAction.ERASE_PROGRAM, plans[0].action);
+                memory.apply(plans);
+
+                byte[] expected = (byte[])before.Clone();
+                Buffer.BlockCopy(image, 0, expected, 0x520, image.Length);
+                CollectionAssert.AreEqual(expected, memory.contents);
+            }
+        }
+
+        [TestMethod]
+        public void PlanSkipsOnHashMatch()
+        {
+            FlashDevice device = smallDevice();
+            FlashMemory memory = new FlashMemory(device);
+            byte[] programmed = pattern(0x800, 1);
+            memory.write(FLASH_START, programmed);
+            Dictionary<UInt32, UInt32> hashes = new Dictionary<UInt32, UInt32>
+            {
+                { FLASH_START, FlashBuilderConsts.crc32(programmed, 0, 0x400) },
+                { FLASH_START + 0x400, 0 },
+            };
+
+            FlashPlanner planner = new FlashPlanner(device);
+            planner.addData(FLASH_START, (byte[])programmed.Clone());
+            List<FlashPlanner.SectorPlan> plans = planner.plan(memory.read, hashes, FlashBuilderConsts.crc32, assume_hash_correct: true);
+
+            Assert.AreEqual(0, memory.reads);
+            Assert.AreEqual(FlashPlanner.SectorAction.SKIP, plans[0].action);
+            Assert.IsTrue(plans[0].hash_only);
+            Assert.AreEqual(FlashPlanner.SectorAction.ERASE_PROGRAM, plans[1].action);
+        }
+    }
+}
@@ -0,0 +1,204 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using Microsoft.VisualStudio.TestTools.UnitTesting;
+using openocd.Debugger;
+
+namespace VK_CMSIS_SVD_Test
+{
+    [TestClass]
+    public class MemoryCacheTest
+    {
+        private const UInt32 RAM_START = 0x20000000;
+        private const UInt32 RAM_SIZE = 0x20000;
+        // Last page of the address space, reached by accesses that end at 0xFFFFFFFF
+        private const UInt32 TOP_START = 0xFFFFF000;
+
+        // Target memory without a core, counts the accesses that reach it
+        private class TargetMemory : DebugContext
+        {
+            public readonly byte[] ram = new byte[RAM_SIZE];
+            public readonly byte[] top = new byte[0x1000];
+            public int reads;
+            public long read_bytes;
+
+            public TargetMemory() : base(null)
+            {
+                Random random = new Random(1);
+                random.NextBytes(this.ram);
+                random.NextBytes(this.top);
+            }
+
+            public byte get(UInt32 addr)
+            {
+                return addr >= TOP_START ? this.top[addr - TOP_START] : this.ram[addr - RAM_START];
+            }
+
+            public override List<byte> readBlockMemoryUnaligned8(UInt32 addr, UInt32 size)
+            {
+                this.reads += 1;
+                this.read_bytes += size;
+                List<byte> data = new List<byte>((int)size);
+                for (UInt32 i = 0; i < size; i++)
+                {
+                    data.Add(this.get(addr + i));
+                }
+                return data;
+            }
+
+            public override void writeBlockMemoryUnaligned8(UInt32 addr, List<byte> value)
+            {
+                for (int i = 0; i < value.Count; i++)
+                {
+                    UInt32 pos = addr + (UInt32)i;
+                    if (pos >= TOP_START)
+                    {
+                        this.top[pos - TOP_START] = value[i];
+                    }
+                    else
+                    {
+                        this.ram[pos - RAM_START] = value[i];
+                    }
+                }
+            }
+        }
+
+        // Halted core with all memory cacheable
+        private class HaltedMemoryCache : MemoryCache
+        {
+            public HaltedMemoryCache(DebugContext context, int max_blocks = MAX_BLOCKS) : base(context, max_blocks)
+            {
+            }
+
+            public override void _check_cache()
+            {
+            }
+
+            public override bool _check_regions(UInt32 addr, UInt32 count)
+            {
+                return true;
+            }
+        }
+
+        private static void assertRead(TargetMemory memory, List<byte> data, UInt32 addr, UInt32 size)
+        {
+            Assert.AreEqual((int)size, data.Count);
+            for (UInt32 i = 0; i < size; i++)
+            {
+                if (data[(int)i] != memory.get(addr + i))
+                {
+                    Assert.Fail(String.Format("Byte at 0x{0:X8} of read 0x{1:X8}+0x{2:X} differs", addr + i, addr, size));
+                }
+            }
+        }
+
+        [TestMethod]
+        public void ReadToTopOfAddressSpace()
+        {
+            TargetMemory memory = new TargetMemory();
+            HaltedMemoryCache cache = new HaltedMemoryCache(memory);
+
+            UInt32 cachedSize;
+            List<Tuple<UInt32, UInt32>> uncached = cache._get_uncached(0xFFFFFFC0, 0x40, out cachedSize);
+            Assert.AreEqual(1, uncached.Count);
+            Assert.AreEqual(Tuple.Create(0xFFFFFFC0U, 0x40U), uncached[0]);
+            Assert.AreEqual(0U, cachedSize);
+
+            assertRead(memory, cache.readBlockMemoryUnaligned8(0xFFFFFFC0, 0x40), 0xFFFFFFC0, 0x40);
+            assertRead(memory, cache.readBlockMemoryUnaligned8(0xFFFFFFFD, 3), 0xFFFFFFFD, 3);
+            assertRead(memory, cache.readBlockMemoryUnaligned8(0xFFFFFF00, 0x100), 0xFFFFFF00, 0x100);
+            Assert.AreEqual(2, memory.reads);
+
+            cache.writeBlockMemoryUnaligned8(0xFFFFFFFC, new List<byte> { 1, 2, 3, 4 });
+            assertRead(memory, cache.readBlockMemoryUnaligned8(0xFFFFFFF0, 0x10), 0xFFFFFFF0, 0x10);
+            Assert.AreEqual(2, memory.reads);
+        }
+
+        [TestMethod]
+        public void CoalescesSmallCachedGaps()
+        {
+            TargetMemory memory = new TargetMemory();
+            HaltedMemoryCache cache = new HaltedMemoryCache(memory);
+            cache.readBlockMemoryUnaligned8(RAM_START + 0x10, 3);
+            cache.readBlockMemoryUnaligned8(RAM_START + 0x20, 3);
+            memory.reads = 0;
+            assertRead(memory, cache.readBlockMemoryUnaligned8(RAM_START + 0xE, 0x60), RAM_START + 0xE, 0x60);
+            Assert.AreEqual(1, memory.reads);
+        }
+
+        [TestMethod]
+        public void ClearsWhenFull()
+        {
+            TargetMemory memory = new TargetMemory();
+            HaltedMemoryCache cache = new HaltedMemoryCache(memory, max_blocks: 16);
+            // Fill the cache, the first block is still cached
+            assertRead(memory, cache.readBlockMemoryUnaligned8(RAM_START, 16 * MemoryCache.BLOCK_SIZE), RAM_START, 16 * MemoryCache.BLOCK_SIZE);
+            assertRead(memory, cache.readBlockMemoryUnaligned8(RAM_START, 4), RAM_START, 4);
+            Assert.AreEqual(1, memory.reads);
+            // One more block clears it
+            UInt32 next = RAM_START + 16 * MemoryCache.BLOCK_SIZE;
+            assertRead(memory, cache.readBlockMemoryUnaligned8(next, 4), next, 4);
+            assertRead(memory, cache.readBlockMemoryUnaligned8(RAM_START, 4), RAM_START, 4);
+            Assert.AreEqual(3, memory.reads);
+            // Larger than the cache is read around it and keeps a write through it correct
+            cache.writeBlockMemoryUnaligned8(RAM_START + 2, new List<byte> { 1, 2 });
+            assertRead(memory, cache.readBlockMemoryUnaligned8(RAM_START, 32 * MemoryCache.BLOCK_SIZE), RAM_START, 32 * MemoryCache.BLOCK_SIZE);
+            cache.writeBlockMemoryUnaligned8(RAM_START, Enumerable.Repeat<byte>(0x5A, 32 * (int)MemoryCache.BLOCK_SIZE).ToList());
+            assertRead(memory, cache.readBlockMemoryUnaligned8(RAM_START, 8), RAM_START, 8);
+        }
+
+        // 
+        //         Replay the accesses of a debugger session while the core is halted:
+        //         stack and variable reads, memory view pages and a few writes
+        // 
+        [TestMethod]
+        [TestCategory("Benchmark")]
+        public void ReplayDebuggerSession()
+        {
+            TargetMemory memory = new TargetMemory();
+            TargetMemory direct = new TargetMemory();
+            HaltedMemoryCache cache = new HaltedMemoryCache(memory);
+            Random random = new Random(7);
+            const int operations = 200000;
+
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            for (int i = 0; i < operations; i++)
+            {
+                int kind = random.Next(10);
+                UInt32 addr;
+                UInt32 size;
+                if (kind < 5)
+                {
+                    // Stack frames and locals near the top of RAM
+                    addr = RAM_START + RAM_SIZE - 0x1000 + (UInt32)random.Next(0, 0x1000 - 64);
+                    size = (UInt32)random.Next(1, 65);
+                }
+                else if (kind < 8)
+                {
+                    // Memory view and globals
+                    addr = RAM_START + (UInt32)random.Next(0, (int)RAM_SIZE - 0x1000 - 1024);
+                    size = (UInt32)random.Next(1, 1025);
+                }
+                else
+                {
+                    addr = RAM_START + (UInt32)random.Next(0, (int)RAM_SIZE - 64);
+                    size = (UInt32)random.Next(1, 65);
+                    byte[] value = new byte[size];
+                    random.NextBytes(value);
+                    cache.writeBlockMemoryUnaligned8(addr, value.ToList());
+                    direct.writeBlockMemoryUnaligned8(addr, value.ToList());
+                    continue;
+                }
+                assertRead(memory, cache.readBlockMemoryUnaligned8(addr, size), addr, size);
+                direct.readBlockMemoryUnaligned8(addr, size);
+            }
+            stopwatch.Stop();
+            Console.WriteLine("{0} operations in {1} ms, {2} target reads of {3} bytes, {4} reads of {5} bytes uncached",
+                operations, stopwatch.ElapsedMilliseconds, memory.reads, memory.read_bytes, direct.reads, direct.read_bytes);
+
+            Assert.IsTrue(memory.read_bytes <= RAM_SIZE);
+            Assert.IsTrue(memory.reads < direct.reads / 10);
+        }
+    }
+}
@@ -0,0 +1,557 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+using System.Threading;
+using System.Threading.Tasks;
+
+namespace openocd.CmsisDap.Backend
+{
+
+    // This class simulates a CMSIS-DAP probe in process:
+    //     - DAP_Transfer / DAP_TransferBlock against a MEM-AP with RAM regions
+    //     - the other commands used by DapAccessLink are acknowledged
+    //     - a USB round trip of usb_latency per packet and a probe that
+    //       executes packets one after the other at the SWJ clock
+    //
+    // It needs no hardware, so the packet pipelining of DapAccessLink can be
+    // measured with getTransferRate() for different packet counts and sizes.
+    //
+    public class BackendSimulated : IBackend
+    {
+        // SWD clocks of one transfer: request, turnaround, ack, data, parity, idle
+        public const UInt32 SWD_CLOCKS_PER_TRANSFER = 46;
+
+        private const UInt32 DP_IDCODE = 0x2BA01477;
+        private const UInt32 CTRLSTAT_POWER_REQ = 0x50000000;
+        private const UInt32 CTRLSTAT_STICKYERR = 0x00000020;
+
+        public byte packet_count { get; set; }
+        public bool isAvailable { get; set; }
+        internal UInt16 packet_size;
+        internal readonly string serial_number;
+
+        // Probe properties reported through DAP_Info
+        public readonly UInt16 max_packet_size;
+        public readonly byte max_packet_count;
+        public TimeSpan usb_latency;
+        public UInt32 swj_clock;
+
+        public UInt32 ap_idr;
+        public UInt32 ap_base;
+
+        // Number of reads until one fails after taking its response, like a
+        // corrupted USB transfer. -1 never fails.
+        public int fail_read;
+
+        private class Region
+        {
+            public readonly UInt32 start;
+            public readonly byte[] data;
+
+            public Region(UInt32 start, UInt32 size)
+            {
+                this.start = start;
+                this.data = new byte[size];
+            }
+
+            public bool contains(UInt32 addr)
+            {
+                return addr >= this.start && addr - this.start <= this.data.Length - 4;
+            }
+        }
+
+        private class Response
+        {
+            public readonly List<byte> data;
+            public readonly long ready_ticks;
+
+            public Response(List<byte> data, long ready_ticks)
+            {
+                this.data = data;
+                this.ready_ticks = ready_ticks;
+            }
+        }
+
+        private readonly List<Region> memory;
+        private readonly Queue<Response> responses;
+        private readonly Stopwatch clock;
+        // Time at which the probe finishes the packets it has already been sent
+        private long probe_free_ticks;
+
+        // DP and MEM-AP state
+        private UInt32 ctrl_stat;
+        private UInt32 select;
+        private UInt32 csw;
+        private UInt32 tar;
+        private UInt32 match_mask;
+
+        // Statistics since resetStats()
+        public UInt64 packets;
+        public UInt64 transfers;
+        private long stats_ticks;
+
+        public BackendSimulated(UInt16 packet_size = 64, byte packet_count = 4, double usb_latency_ms = 1.0, string serial_number = "SIMULATED")
+        {
+            this.max_packet_size = packet_size;
+            this.max_packet_count = packet_count;
+            this.packet_size = packet_size;
+            this.packet_count = packet_count;
+            this.usb_latency = TimeSpan.FromMilliseconds(usb_latency_ms);
+            this.swj_clock = 1000000;
+            this.serial_number = serial_number;
+            this.ap_idr = 0x24770011; // AHB-AP of a Cortex-M3/M4
+            this.ap_base = 0xFFFFFFFF; // No ROM table
+            this.fail_read = -1;
+            this.memory = new List<Region>();
+            this.responses = new Queue<Response>();
+            this.clock = Stopwatch.StartNew();
+            this.isAvailable = true;
+            this.resetStats();
+        }
+
+        //
+        //         Add a RAM region the simulated MEM-AP can access, other addresses fault
+        //
+        public void addMemory(UInt32 start, UInt32 size)
+        {
+            Debug.Assert((start & 3) == 0 && (size & 3) == 0 && size > 0);
+            this.memory.Add(new Region(start, size));
+        }
+
+        public void resetStats()
+        {
+            lock (this.responses)
+            {
+                this.packets = 0;
+                this.transfers = 0;
+                this.stats_ticks = this.clock.ElapsedTicks;
+            }
+        }
+
+        //
+        //         Register transfers per second since resetStats()
+        //
+        public double getTransferRate()
+        {
+            double seconds = (double)(this.clock.ElapsedTicks - this.stats_ticks) / Stopwatch.Frequency;
+            return seconds == 0 ? 0 : this.transfers / seconds;
+        }
+
+        public string getInfo()
+        {
+            return String.Format("Simulated CMSIS-DAP, {0} x {1} byte packets, {2} ms latency",
+                this.max_packet_count, this.max_packet_size, this.usb_latency.TotalMilliseconds);
+        }
+
+        public void init()
+        {
+        }
+
+        public void open()
+        {
+            lock (this.responses)
+            {
+                this.responses.Clear();
+                this.probe_free_ticks = 0;
+            }
+        }
+
+        //
+        //         Send one packet to the probe
+        //
+        //         The response becomes readable once the packet has crossed the USB,
+        //         waited for the packets queued before it and been executed.
+        //
+        public void write(List<byte> data)
+        {
+            Debug.Assert(data.Count <= this.packet_size);
+            lock (this.responses)
+            {
+                if (this.responses.Count >= this.max_packet_count)
+                {
+                    // A real probe would NAK the packet
+                    throw new DeviceError();
+                }
+                long half_latency = (long)(this.usb_latency.TotalSeconds * Stopwatch.Frequency / 2);
+                long arrival = this.clock.ElapsedTicks + half_latency;
+                UInt32 transfer_count;
+                List<byte> response = this._execute(data, out transfer_count);
+                long execution = (long)((double)transfer_count * SWD_CLOCKS_PER_TRANSFER / this.swj_clock * Stopwatch.Frequency);
+                this.probe_free_ticks = Math.Max(arrival, this.probe_free_ticks) + execution;
+                while (response.Count < this.packet_size)
+                {
+                    response.Add(0);
+                }
+                this.responses.Enqueue(new Response(response, this.probe_free_ticks + half_latency));
+                this.packets += 1;
+                this.transfers += transfer_count;
+                Monitor.PulseAll(this.responses);
+            }
+        }
+
+        //
+        //         Wait for the response to the oldest packet
+        //
+        public List<byte> read(int size = -1, int timeout = -1)
+        {
+            Response response;
+            lock (this.responses)
+            {
+                while (this.responses.Count == 0)
+                {
+                    if (!Monitor.Wait(this.responses, timeout))
+                    {
+                        throw new TimeoutException("No packet to read");
+                    }
+                }
+                response = this.responses.Peek();
+            }
+            while (true)
+            {
+                long remaining = response.ready_ticks - this.clock.ElapsedTicks;
+                if (remaining <= 0)
+                {
+                    break;
+                }
+                int remaining_ms = (int)(remaining * 1000 / Stopwatch.Frequency);
+                if (remaining_ms > 1)
+                {
+                    Thread.Sleep(remaining_ms - 1);
+                }
+                else
+                {
+                    Thread.Yield();
+                }
+            }
+            lock (this.responses)
+            {
+                this.responses.Dequeue();
+                if (this.fail_read >= 0 && this.fail_read-- == 0)
+                {
+                    throw new DeviceError();
+                }
+            }
+            return response.data;
+        }
+
+        public virtual string getSerialNumber()
+        {
+            return this.serial_number;
+        }
+
+        public void close()
+        {
+            Trace.TraceInformation("closing simulated interface");
+        }
+
+        public void setPacketSize(UInt16 size)
+        {
+            Debug.Assert(size <= this.max_packet_size);
+            this.packet_size = size;
+        }
+
+        //
+        //         Execute a command packet and build its response
+        //
+        private List<byte> _execute(List<byte> cmd, out UInt32 transfer_count)
+        {
+            transfer_count = 0;
+            EDapCommandByte command = (EDapCommandByte)cmd[0];
+            List<byte> resp = new List<byte>() { cmd[0] };
+            switch (command)
+            {
+                case EDapCommandByte.DAP_INFO:
+                    this._info((EDapInfoIDByte)cmd[1], resp);
+                    break;
+                case EDapCommandByte.DAP_CONNECT:
+                    EDapConnectPortModeByte mode = (EDapConnectPortModeByte)cmd[1];
+                    resp.Add((byte)(mode == EDapConnectPortModeByte.JTAG ? EDapConnectPortModeByte.DEFAULT : EDapConnectPortModeByte.SWD));
+                    break;
+                case EDapCommandByte.DAP_SWJ_CLOCK:
+                    UInt32 frequency = (UInt32)cmd[1] | (UInt32)cmd[2] << 8 | (UInt32)cmd[3] << 16 | (UInt32)cmd[4] << 24;
+                    if (frequency != 0)
+                    {
+                        this.swj_clock = frequency;
+                    }
+                    resp.Add((byte)EDapReponseStatusByte.DAP_OK);
+                    break;
+                case EDapCommandByte.DAP_SWJ_PINS:
+                    resp.Add(cmd[1]);
+                    break;
+                case EDapCommandByte.DAP_HOST_STATUS_LED:
+                case EDapCommandByte.DAP_DISCONNECT:
+                case EDapCommandByte.DAP_TRANSFER_CONFIGURE:
+                case EDapCommandByte.DAP_WRITE_ABORT:
+                case EDapCommandByte.DAP_SWJ_SEQUENCE:
+                case EDapCommandByte.DAP_SWD_CONFIGURE:
+                    resp.Add((byte)EDapReponseStatusByte.DAP_OK);
+                    break;
+                case EDapCommandByte.DAP_RESET_TARGET:
+                    resp.Add((byte)EDapReponseStatusByte.DAP_OK);
+                    resp.Add((byte)EDapResetTargetResultByte.NO_DEVICE_SPECIFIC_RESET_SEQ_IMPLEMENTED);
+                    break;
+                case EDapCommandByte.DAP_TRANSFER:
+                    transfer_count = this._transfer(cmd, resp);
+                    break;
+                case EDapCommandByte.DAP_TRANSFER_BLOCK:
+                    transfer_count = this._transfer_block(cmd, resp);
+                    break;
+                default:
+                    // DAP_Invalid
+                    resp[0] = 0xFF;
+                    break;
+            }
+            return resp;
+        }
+
+        private void _info(EDapInfoIDByte id_, List<byte> resp)
+        {
+            switch (id_)
+            {
+                case EDapInfoIDByte.CAPABILITIES:
+                    resp.Add(1);
+                    resp.Add(0x01); // SWD
+                    break;
+                case EDapInfoIDByte.MAX_PACKET_COUNT:
+                    resp.Add(1);
+                    resp.Add(this.max_packet_count);
+                    break;
+                case EDapInfoIDByte.MAX_PACKET_SIZE:
+                    resp.Add(2);
+                    resp.Add((byte)(this.max_packet_size & 0xFF));
+                    resp.Add((byte)(this.max_packet_size >> 8));
+                    break;
+                case EDapInfoIDByte.VENDOR:
+                case EDapInfoIDByte.PRODUCT:
+                case EDapInfoIDByte.SER_NUM:
+                case EDapInfoIDByte.FW_VER:
+                    string value = id_ == EDapInfoIDByte.SER_NUM ? this.serial_number : id_ == EDapInfoIDByte.FW_VER ? "2.0.0" : "Simulated";
+                    resp.Add((byte)(value.Length + 1));
+                    resp.AddRange(Encoding.ASCII.GetBytes(value));
+                    resp.Add(0);
+                    break;
+                default:
+                    resp.Add(0);
+                    break;
+            }
+        }
+
+        // DAP_Transfer: one request byte per transfer, followed by data for writes
+        private UInt32 _transfer(List<byte> cmd, List<byte> resp)
+        {
+            byte count = cmd[2];
+            int pos = 3;
+            byte done = 0;
+            EDapTransferResponseByte ack = EDapTransferResponseByte.DAP_TRANSFER_SWD_OK;
+            List<byte> data = new List<byte>();
+            while (done < count)
+            {
+                EDapTransferRequestByte request = (EDapTransferRequestByte)cmd[pos];
+                pos += 1;
+                UInt32 value = 0;
+                if ((request & EDapTransferRequestByte.READ) == 0 || (request & EDapTransferRequestByte.Value_Match) != 0)
+                {
+                    value = (UInt32)cmd[pos] | (UInt32)cmd[pos + 1] << 8 | (UInt32)cmd[pos + 2] << 16 | (UInt32)cmd[pos + 3] << 24;
+                    pos += 4;
+                }
+                UInt32 result;
+                ack = this._access(request, value, out result);
+                if (ack != EDapTransferResponseByte.DAP_TRANSFER_SWD_OK)
+                {
+                    break;
+                }
+                if ((request & EDapTransferRequestByte.READ) != 0)
+                {
+                    if ((request & EDapTransferRequestByte.Value_Match) != 0)
+                    {
+                        if ((result & this.match_mask) != value)
+                        {
+                            ack |= EDapTransferResponseByte.DAP_VALUE_MISMATCH;
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        data.AddRange(BitConverter.GetBytes(result));
+                    }
+                }
+                done += 1;
+            }
+            resp.Add(done);
+            resp.Add((byte)ack);
+            resp.AddRange(data);
+            return done;
+        }
+
+        // DAP_TransferBlock: one request byte for all transfers
+        private UInt32 _transfer_block(List<byte> cmd, List<byte> resp)
+        {
+            UInt16 count = (UInt16)(cmd[2] | cmd[3] << 8);
+            EDapTransferRequestByte request = (EDapTransferRequestByte)cmd[4];
+            int pos = 5;
+            UInt16 done = 0;
+            EDapTransferResponseByte ack = EDapTransferResponseByte.DAP_TRANSFER_SWD_OK;
+            List<byte> data = new List<byte>();
+            while (done < count)
+            {
+                UInt32 value = 0;
+                if ((request & EDapTransferRequestByte.READ) == 0)
+                {
+                    value = (UInt32)cmd[pos] | (UInt32)cmd[pos + 1] << 8 | (UInt32)cmd[pos + 2] << 16 | (UInt32)cmd[pos + 3] << 24;
+                    pos += 4;
+                }
+                UInt32 result;
+                ack = this._access(request, value, out result);
+                if (ack != EDapTransferResponseByte.DAP_TRANSFER_SWD_OK)
+                {
+                    break;
+                }
+                if ((request & EDapTransferRequestByte.READ) != 0)
+                {
+                    data.AddRange(BitConverter.GetBytes(result));
+                }
+                done += 1;
+            }
+            resp.Add((byte)(done & 0xFF));
+            resp.Add((byte)(done >> 8));
+            resp.Add((byte)ack);
+            resp.AddRange(data);
+            return done;
+        }
+
+        //
+        //         Perform one DP or AP register access
+        //
+        private EDapTransferResponseByte _access(EDapTransferRequestByte request, UInt32 value, out UInt32 result)
+        {
+            result = 0;
+            bool is_read = (request & EDapTransferRequestByte.READ) != 0;
+            UInt32 a3_a2 = (UInt32)request & 0x0C;
+            if ((request & EDapTransferRequestByte.AP_ACC) == 0)
+            {
+                switch (a3_a2)
+                {
+                    case 0x0:
+                        // IDCODE / ABORT
+                        if (is_read)
+                        {
+                            result = DP_IDCODE;
+                        }
+                        else if ((value & 0x4) != 0)
+                        {
+                            this.ctrl_stat &= ~CTRLSTAT_STICKYERR;
+                        }
+                        break;
+                    case 0x4:
+                        if (is_read)
+                        {
+                            // Acknowledge the power up requests
+                            result = this.ctrl_stat | ((this.ctrl_stat & CTRLSTAT_POWER_REQ) << 1);
+                        }
+                        else
+                        {
+                            this.ctrl_stat = value & ~CTRLSTAT_STICKYERR;
+                        }
+                        break;
+                    case 0x8:
+                        if (!is_read)
+                        {
+                            this.select = value;
+                        }
+                        break;
+                    default:
+                        // RDBUFF
+                        break;
+                }
+                if (!is_read && (request & EDapTransferRequestByte.Match_Mask) != 0)
+                {
+                    this.match_mask = value;
+                }
+                return EDapTransferResponseByte.DAP_TRANSFER_SWD_OK;
+            }
+            if ((this.select & 0xFF000000) != 0)
+            {
+                // Only AP #0 exists
+                return EDapTransferResponseByte.DAP_TRANSFER_FAULT;
+            }
+            UInt32 reg = (this.select & 0xF0) | a3_a2;
+            if (!is_read && (request & EDapTransferRequestByte.Match_Mask) != 0)
+            {
+                this.match_mask = value;
+                return EDapTransferResponseByte.DAP_TRANSFER_SWD_OK;
+            }
+            switch (reg)
+            {
+                case 0x00:
+                    if (is_read)
+                    {
+                        result = this.csw;
+                    }
+                    else
+                    {
+                        this.csw = value;
+                    }
+                    break;
+                case 0x04:
+                    if (is_read)
+                    {
+                        result = this.tar;
+                    }
+                    else
+                    {
+                        this.tar = value;
+                    }
+                    break;
+                case 0x0C:
+                    return this._drw(is_read, value, out result);
+                case 0xF8:
+                    result = this.ap_base;
+                    break;
+                case 0xFC:
+                    result = this.ap_idr;
+                    break;
+            }
+            return EDapTransferResponseByte.DAP_TRANSFER_SWD_OK;
+        }
+
+        //
+        //         Access memory at TAR and auto increment it within the wrap size of ap_idr
+        //
+        private EDapTransferResponseByte _drw(bool is_read, UInt32 value, out UInt32 result)
+        {
+            result = 0;
+            int size = 1 << (int)(this.csw & 0x7);
+            UInt32 word_addr = this.tar & ~3U;
+            Region region = this.memory.FirstOrDefault(r => r.contains(word_addr));
+            if (size > 4 || region == null)
+            {
+                this.ctrl_stat |= CTRLSTAT_STICKYERR;
+                return EDapTransferResponseByte.DAP_TRANSFER_FAULT;
+            }
+            int offset = (int)(word_addr - region.start);
+            if (is_read)
+            {
+                // Data is returned on its byte lanes
+                result = BitConverter.ToUInt32(region.data, offset);
+            }
+            else
+            {
+                int lane = (int)(this.tar & 3) & ~(size - 1);
+                for (int i = lane; i < lane + size; i++)
+                {
+                    region.data[offset + i] = (byte)((value >> (8 * i)) & 0xFF);
+                }
+            }
+            if ((this.csw & 0x30) == 0x10)
+            {
+                // Same wrap as MEM_AP.init() assumes, 1kB for unknown APs
+                UInt16 wrap_size;
+                UInt32 wrap_mask = CoreSight.AccessPort.MEM_AP_IDR_TO_WRAP_SIZE.TryGetValue(this.ap_idr, out wrap_size) ? (UInt32)wrap_size - 1 : 0x3FF;
+                this.tar = (this.tar & ~wrap_mask) | ((this.tar + (UInt32)size) & wrap_mask);
+            }
+            return EDapTransferResponseByte.DAP_TRANSFER_SWD_OK;
+        }
+    }
+}
@@ -52,27 +52,29 @@ namespace openocd.CmsisDap
         //         
         public virtual UInt16 _get_free_words(bool blockAllowed, bool isRead)
         {
-            UInt16 recv;
-            UInt16 send;
+            // Signed, a packet that already holds block data can have no
+            // room left for non-block transfers
+            int recv;
+            int send;
             if (blockAllowed)
             {
                 // DAP_TransferBlock request packet:
                 //   BYTE | BYTE *****| SHORT**********| BYTE *************| WORD *********|
                 // > 0x06 | DAP Index | Transfer Count | Transfer Request  | Transfer Data |
                 //  ******|***********|****************|*******************|+++++++++++++++|
-                send = (UInt16)(this._size - 5 - 4 * this._write_count);
+                send = this._size - 5 - 4 * this._write_count;
                 // DAP_TransferBlock response packet:
                 //   BYTE | SHORT *********| BYTE *************| WORD *********|
                 // < 0x06 | Transfer Count | Transfer Response | Transfer Data |
                 //  ******|****************|*******************|+++++++++++++++|
-                recv = (UInt16)(this._size - 4 - 4 * this._read_count);
+                recv = this._size - 4 - 4 * this._read_count;
                 if (isRead)
                 {
-                    return (UInt16)(recv / 4);
+                    return (UInt16)Math.Max(recv / 4, 0);
                 }
                 else
                 {
-                    return (UInt16)(send / 4);
+                    return (UInt16)Math.Max(send / 4, 0);
                 }
             }
             else
@@ -81,21 +83,21 @@ namespace openocd.CmsisDap
                 //   BYTE | BYTE *****| BYTE **********| BYTE *************| WORD *********|
                 // > 0x05 | DAP Index | Transfer Count | Transfer Request  | Transfer Data |
                 //  ******|***********|****************|+++++++++++++++++++++++++++++++++++|
-                send = (UInt16)(this._size - 3 - 1 * this._read_count - 5 * this._write_count);
+                send = this._size - 3 - 1 * this._read_count - 5 * this._write_count;
                 // DAP_Transfer response packet:
                 //   BYTE | BYTE **********| BYTE *************| WORD *********|
                 // < 0x05 | Transfer Count | Transfer Response | Transfer Data |
                 //  ******|****************|*******************|+++++++++++++++|
-                recv = (UInt16)(this._size - 3 - 4 * this._read_count);
+                recv = this._size - 3 - 4 * this._read_count;
                 if (isRead)
                 {
                     // 1 request byte in request packet, 4 data bytes in response packet
-                    return Math.Min(send, (UInt16)(recv / 4));
+                    return (UInt16)Math.Max(Math.Min(send, recv / 4), 0);
                 }
                 else
                 {
                     // 1 request byte + 4 data bytes
-                    return (UInt16)(send / 5);
+                    return (UInt16)Math.Max(send / 5, 0);
                 }
             }
         }
@@ -39,6 +39,8 @@ namespace openocd.CmsisDap
         public static readonly string ws_host = "localhost";
         public static readonly UInt16 ws_port = 8081;
         public static readonly bool limit_packets = false;
+        // Read responses in the background so packet_count packets stay in flight
+        public static readonly bool pipeline_reads = true;
     }
 
 }
@@ -93,6 +93,9 @@ namespace openocd.CmsisDap
         private byte? _packet_count;
         private UInt16? _packet_size;
         internal List<Command> _commands_to_read;
+        // Pending reads of the responses to _commands_to_read, in the same order
+        private List<Task<List<byte>>> _responses_to_read;
+        private Task<List<byte>> _last_read;
         private List<byte> _command_response_buf;
 
         public DapAccessLink(string unique_id, IBackend backend_interface = null)
@@ -109,6 +112,8 @@ namespace openocd.CmsisDap
             this._crnt_cmd = null;
             this._packet_size = null;
             this._commands_to_read = null;
+            this._responses_to_read = null;
+            this._last_read = null;
             this._command_response_buf = null;
             //this._logger = logging.getLogger(@__name__);
             return;
@@ -241,6 +246,11 @@ namespace openocd.CmsisDap
             this._deferred_transfer = enable;
         }
 
+        public bool get_deferred_transfer()
+        {
+            return this._deferred_transfer;
+        }
+
         public void flush()
         {
             // Send current packet
@@ -399,8 +409,9 @@ namespace openocd.CmsisDap
             this._crnt_cmd = new Command((UInt16)this._packet_size);
             // Packets that have been sent but not read
             this._commands_to_read = new List<Command>(); // collections.deque();
-                                                          // Buffer for data returned for completed commands.
-                                                          // This data will be added to transfers
+            this._responses_to_read = new List<Task<List<byte>>>();
+            // Buffer for data returned for completed commands.
+            // This data will be added to transfers
             this._command_response_buf = new List<byte>();
         }
 
@@ -417,9 +428,11 @@ namespace openocd.CmsisDap
             // Grab command, send it and decode response
             Command cmd = this._commands_to_read[0];
             this._commands_to_read.RemoveAt(0); // popleft();
+            Task<List<byte>> response = this._responses_to_read[0];
+            this._responses_to_read.RemoveAt(0);
             try
             {
-                List<byte> raw_data = this._backend_interface.read();
+                List<byte> raw_data = response != null ? response.GetAwaiter().GetResult() : this._backend_interface.read();
                 decoded_data = cmd.decode_data(raw_data);
             }
             catch (Exception e)
@@ -489,9 +502,42 @@ namespace openocd.CmsisDap
                 throw;
             }
             this._commands_to_read.Add(cmd);
+            this._responses_to_read.Add(this._start_read());
             this._crnt_cmd = new Command((UInt16)this._packet_size);
         }
 
+        // 
+        //         Start reading the response to the packet just sent
+        // 
+        //         The reads are chained so responses are taken from the interface
+        //         in the order the packets were sent. While they run in the
+        //         background the next packets are encoded and written, which keeps
+        //         up to packet_count packets queued in the probe. Returns null if
+        //         pipelined reads are disabled, _read_packet then reads inline.
+        //         
+        public virtual Task<List<byte>> _start_read()
+        {
+            if (!DapSettings.pipeline_reads)
+            {
+                return null;
+            }
+            IBackend backend = this._backend_interface;
+            if (this._last_read == null || this._last_read.IsCompleted)
+            {
+                this._last_read = Task.Run(() => backend.read());
+            }
+            else
+            {
+                // A failed read leaves the stream out of step, cancel the reads queued behind it
+                this._last_read = this._last_read.ContinueWith(
+                    previous => backend.read(),
+                    CancellationToken.None,
+                    TaskContinuationOptions.OnlyOnRanToCompletion,
+                    TaskScheduler.Default);
+            }
+            return this._last_read;
+        }
+
         // 
         //         Write one or more commands
         //         
@@ -577,23 +623,41 @@ namespace openocd.CmsisDap
         //         
         public virtual void _abort_all_transfers(Exception exception)
         {
-            var pending_reads = this._commands_to_read.Count;
+            var pending_reads = this._responses_to_read;
             // invalidate _transfer_list
             foreach (var transfer in this._transfer_list)
             {
                 transfer.add_error(exception);
             }
-            // clear all deferred buffers
+            // clear all deferred buffers, the next packet starts a new chain of reads
             this._init_deferred_buffers();
-            // finish all pending reads and ignore the data
-            // Only do this if the error is a tranfer error.
-            // Otherwise this could cause another exception
-            if (exception is TransferError)
+            this._last_read = null;
+            // finish all pending reads and ignore the data, whatever the error,
+            // so no response is left for a later packet to take
+            foreach (var response in pending_reads)
             {
-                foreach (var _ in Enumerable.Range(0, pending_reads))
+                if (response != null)
+                {
+                    // Already reading in the background, only wait for it
+                    try
+                    {
+                        response.Wait();
+                        continue;
+                    }
+                    catch (AggregateException)
+                    {
+                        // Cancelled behind a failed read, the response is still in the probe
+                    }
+                }
+                try
                 {
                     this._backend_interface.read();
                 }
+                catch (Exception)
+                {
+                    // The interface stopped responding, nothing more to drain
+                    break;
+                }
             }
         }
 
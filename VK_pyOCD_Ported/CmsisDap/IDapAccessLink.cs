@@ -158,6 +158,9 @@ namespace openocd.CmsisDap
         // Allow reads and writes to be buffered for increased speed
         void set_deferred_transfer(bool enable);
 
+        // Return True if reads and writes are currently buffered
+        bool get_deferred_transfer();
+
         // Write out all unsent commands
         void flush();
 
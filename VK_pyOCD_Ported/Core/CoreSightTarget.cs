@@ -130,8 +130,7 @@ namespace openocd.Core
         public virtual void add_core(CortexM core)
         {
             this.cores[core.core_number] = core;
-            ///this.cores[core.core_number].setTargetContext(new CachingDebugContext(core, new Debugger.DebugContext(core)));
-            this.cores[core.core_number].setTargetContext(new Debugger.DebugContext(core));
+            this.cores[core.core_number].setTargetContext(new Debugger.CachingDebugContext(core, new Debugger.DebugContext(core)));
             this._root_contexts[core.core_number] = null;
         }
 
@@ -162,7 +162,7 @@ namespace openocd.Core
                 bool isPoweredOnBoot = true,
                 bool isCacheable = true,
                 bool invalidateCacheOnRun = true)
-                : base(end: end, length: length)
+                : base(start: start, end: end, length: length)
             {
                 this._blocksize = blocksize;
                 if (String.IsNullOrWhiteSpace(name))
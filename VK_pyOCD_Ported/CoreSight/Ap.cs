@@ -300,7 +300,7 @@ namespace openocd.CoreSight
         }
 
         // read aligned word (the size is in words)
-        public virtual List<UInt32> _readBlock32(UInt32 addr, UInt16 size)
+        public virtual Func<List<UInt32>> _readBlock32(UInt32 addr, UInt16 size, bool now = true)
         {
             var num = this.dp.next_access_number;
             if (DebugAccessPort.LOG_DAP)
@@ -310,11 +310,11 @@ namespace openocd.CoreSight
             // put address in TAR
             this.write_reg(DebugAccessPort.AP_REG["CSW"], CSW_VALUE | CSW_SIZE32);
             this.write_reg(DebugAccessPort.AP_REG["TAR"], addr);
-            List<UInt32> resp;
+            Func<List<UInt32>> result_cb;
             try
             {
                 REG_APnDP_A3_A2 reg = DebugAccessPort._ap_addr_to_reg((this.ap_num << DebugAccessPort.APSEL_SHIFT) | DebugAccessPort.READ | DebugAccessPort.AP_ACC | DebugAccessPort.AP_REG["DRW"]);
-                resp = this.link.reg_read_repeat(size, reg)();
+                result_cb = this.link.reg_read_repeat(size, reg, now: false);
             }
             catch (Exception error)
             {
@@ -322,11 +322,34 @@ namespace openocd.CoreSight
                 this._handle_error(error, num);
                 throw new Exception(string.Format("Fault Address {0:X8}", addr), error); // error.fault_address = addr;
             }
-            if (DebugAccessPort.LOG_DAP)
+            List<UInt32> readBlockCb()
             {
-                Trace.TraceInformation("_readBlock32:%06d }", num);
+                List<UInt32> resp;
+                try
+                {
+                    resp = result_cb();
+                }
+                catch (Exception error)
+                {
+                    // Annotate error with target address.
+                    this._handle_error(error, num);
+                    throw new Exception(string.Format("Fault Address {0:X8}", addr), error); // error.fault_address = addr;
+                }
+                if (DebugAccessPort.LOG_DAP)
+                {
+                    Trace.TraceInformation("_readBlock32:%06d }", num);
+                }
+                return resp;
+            }
+            if (now)
+            {
+                var result = readBlockCb();
+                return new Func<List<UInt32>>(() => result);
+            }
+            else
+            {
+                return readBlockCb;
             }
-            return resp;
         }
 
         // Shorthand to write a 32-bit word.
@@ -464,20 +487,46 @@ namespace openocd.CoreSight
         }
 
         // Write a block of aligned words in memory.
+        //
+        // The chunks are sent with deferred transfers so the packets of one
+        // chunk queue up behind the previous one instead of waiting for it.
         public virtual void writeBlockMemoryAligned32(UInt32 addr, List<UInt32> data)
         {
+            UInt32 start_addr = addr;
             UInt32 size = (UInt32)data.Count;
-            while (size > 0)
+            int pos = 0;
+            bool deferred = this.link.get_deferred_transfer();
+            this.link.set_deferred_transfer(true);
+            try
             {
-                UInt32 n = this.auto_increment_page_size - (addr & (this.auto_increment_page_size - 1));
-                if (size * 4 < n)
+                while (size > 0)
                 {
-                    n = (size * 4) & 0xfffffffc;
+                    UInt32 n = this.auto_increment_page_size - (addr & (this.auto_increment_page_size - 1));
+                    if (size * 4 < n)
+                    {
+                        n = (size * 4) & 0xfffffffc;
+                    }
+                    this._writeBlock32(addr, data.GetRange(pos, (int)n / 4)); // VK: Floor division
+                    pos += (int)n / 4;
+                    size -= n / 4;
+                    addr += n;
                 }
-                this._writeBlock32(addr, data.GetRange(0, (int)n / 4)); // VK: Floor division
-                data = data.GetRange((int)n / 4, data.Count - (int)n / 4);
-                size -= n / 4;
-                addr += n;
+            }
+            catch (Exception error)
+            {
+                this._restore_deferred_transfer(deferred, error);
+                throw;
+            }
+            try
+            {
+                // Leaving deferred mode flushes and reports any write error
+                this.link.set_deferred_transfer(deferred);
+            }
+            catch (Exception error)
+            {
+                // Annotate error with the block address, the failing chunk is not known after the flush.
+                this._handle_error(error, this.dp.next_access_number);
+                throw new Exception(string.Format("Fault Address {0:X8}", start_addr), error); // error.fault_address = addr;
             }
             return;
         }
@@ -485,23 +534,58 @@ namespace openocd.CoreSight
         // Read a block of aligned words in memory.
         //
         // @return An array of word values
+        //
+        // All chunks are queued before the first result is collected, so
+        // the reads stay pipelined across auto increment page boundaries.
         public virtual List<UInt32> readBlockMemoryAligned32(UInt32 addr, UInt32 size)
         {
-            List<UInt32> resp = new List<UInt32>();
-            while (size > 0)
+            List<Func<List<UInt32>>> chunks = new List<Func<List<UInt32>>>();
+            List<UInt32> resp = new List<UInt32>((int)size);
+            bool deferred = this.link.get_deferred_transfer();
+            this.link.set_deferred_transfer(true);
+            try
             {
-                UInt32 n = this.auto_increment_page_size - (addr & (this.auto_increment_page_size - 1));
-                if (size * 4 < n)
+                while (size > 0)
+                {
+                    UInt32 n = this.auto_increment_page_size - (addr & (this.auto_increment_page_size - 1));
+                    if (size * 4 < n)
+                    {
+                        n = (size * 4) & 0xfffffffc;
+                    }
+                    chunks.Add(this._readBlock32(addr, (UInt16)(n / 4), now: false));
+                    size -= n / 4;
+                    addr += n;
+                }
+                foreach (var chunk in chunks)
                 {
-                    n = (size * 4) & 0xfffffffc;
+                    resp.AddRange(chunk());
                 }
-                resp.AddRange(this._readBlock32(addr, (UInt16)(n / 4)));
-                size -= n / 4;
-                addr += n;
             }
+            catch (Exception error)
+            {
+                this._restore_deferred_transfer(deferred, error);
+                throw;
+            }
+            this.link.set_deferred_transfer(deferred);
             return resp;
         }
 
+        // Restore the deferred mode after a failed block transfer.
+        //
+        // Leaving deferred mode flushes the link. A failure of that flush is
+        // attached to the original error instead of replacing it.
+        private void _restore_deferred_transfer(bool deferred, Exception error)
+        {
+            try
+            {
+                this.link.set_deferred_transfer(deferred);
+            }
+            catch (Exception flush_error)
+            {
+                error.Data["flush_error"] = flush_error;
+            }
+        }
+
         public virtual void _handle_error(Exception error, int num)
         {
             this.dp._handle_error(error, num);
@@ -331,7 +331,7 @@ namespace openocd.CoreSight
         private string targetXML;
         private List<RegisterInfo> register_list;
 
-        public override int run_token => 0;
+        public override int run_token => this._run_token;
 
         public CortexM(IDapAccessLink link,
             DebugAccessPort dp,
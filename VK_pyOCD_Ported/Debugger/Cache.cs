@@ -6,7 +6,6 @@ namespace openocd.Debugger
     using System.Collections;
     using System.Diagnostics;
     using openocd.CoreSight;
-    using RangeTree;
     using openocd.Utility;
 
     public class MemoryAccessError
@@ -14,142 +13,6 @@ namespace openocd.Debugger
     {
     }
 
-    /// <summary>
-    /// A simple example cass, which contains an integer range and a text property.
-    /// </summary>
-    public class RangeItem : IRangeProvider<UInt32>
-    {
-        /// <summary>
-        /// Initializes a new instance of the <see cref="RangeItem"/> class.
-        /// </summary>
-        /// <param name="a">a.</param>
-        /// <param name="b">The b.</param>
-        public RangeItem(UInt32 a, UInt32 b, List<byte> data = null)
-        {
-            Range = new Range<UInt32>(a, b);
-        }
-
-        /// <summary>
-        /// Gets or sets the range.
-        /// </summary>
-        /// <value>
-        /// The range.
-        /// </value>
-        public Range<UInt32> Range
-        {
-            get;
-            set;
-        }
-
-        /// <summary>
-        /// Returns a <see cref="string" /> that represents this instance.
-        /// </summary>
-        /// <returns>
-        /// A <see cref="string" /> that represents this instance.
-        /// </returns>
-        public override string ToString()
-        {
-            return string.Format("({0} .. {1})", Range.From, Range.To);
-        }
-
-        /// <summary>
-        /// Determines whether the specified <see cref="RangeItem" />, is equal to this instance.
-        /// </summary>
-        /// <param name="other">The <see cref="RangeItem" /> to compare with this instance.</param>
-        /// <returns>
-        ///     <c>true</c> if the specified <see cref="RangeItem" /> is equal to this instance; otherwise, <c>false</c>.
-        /// </returns>
-        protected bool Equals(RangeItem other)
-        {
-            return Range.Equals(other.Range);
-        }
-
-        /// <summary>
-        /// Determines whether the specified <see cref="object" />, is equal to this instance.
-        /// </summary>
-        /// <param name="obj">The <see cref="object" /> to compare with this instance.</param>
-        /// <returns>
-        ///   <c>true</c> if the specified <see cref="object" /> is equal to this instance; otherwise, <c>false</c>.
-        /// </returns>
-        public override bool Equals(object obj)
-        {
-            if (ReferenceEquals(null, obj))
-            {
-                return false;
-            }
-
-            if (ReferenceEquals(this, obj))
-            {
-                return true;
-            }
-
-            if (obj.GetType() != this.GetType())
-            {
-                return false;
-            }
-
-            return Equals((RangeItem)obj);
-        }
-
-        /// <summary>
-        /// Returns a hash code for this instance.
-        /// </summary>
-        /// <returns>
-        /// A hash code for this instance, suitable for use in hashing algorithms and data structures like a hash table. 
-        /// </returns>
-        public override int GetHashCode()
-        {
-            unchecked
-            {
-                return ((0) * 397) ^ Range.GetHashCode();
-            }
-        }
-
-        /// <summary>
-        /// Implements the operator ==.
-        /// </summary>
-        /// <param name="left">The left.</param>
-        /// <param name="right">The right.</param>
-        /// <returns>
-        /// The result of the operator.
-        /// </returns>
-        public static bool operator ==(RangeItem left, RangeItem right)
-        {
-            return Equals(left, right);
-        }
-
-        /// <summary>
-        /// Implements the operator !=.
-        /// </summary>
-        /// <param name="left">The left.</param>
-        /// <param name="right">The right.</param>
-        /// <returns>
-        /// The result of the operator.
-        /// </returns>
-        public static bool operator !=(RangeItem left, RangeItem right)
-        {
-            return !Equals(left, right);
-        }
-    }
-
-    /// <summary>
-    /// Compares two range items by comparing their ranges.
-    /// </summary>
-    public class RangeItemComparer : IComparer<RangeItem>
-    {
-        /// <summary>
-        /// Compares two objects and returns a value indicating whether one is less than, equal to, or greater than the other.
-        /// </summary>
-        /// <param name="x">The first object to compare.</param>
-        /// <param name="y">The second object to compare.</param>
-        /// <returns>
-        /// A signed integer that indicates the relative values of <paramref name="x" /> and <paramref name="y" />, as shown in the following table.Value Meaning Less than zero<paramref name="x" /> is less than <paramref name="y" />.Zero<paramref name="x" /> equals <paramref name="y" />.Greater than zero<paramref name="x" /> is greater than <paramref name="y" />.
-        /// </returns>
-        public int Compare(RangeItem x, RangeItem y)
-        {
-            return x.Range.CompareTo(y.Range);
-        }
-    }
     public class CacheMetrics
     {
         internal UInt32 hits;
@@ -206,7 +69,7 @@ namespace openocd.Debugger
 
     public class RegisterCache
     {
-        internal Dictionary<object, object> _cache;
+        internal Dictionary<sbyte, UInt32> _cache;
         internal CacheMetrics _metrics;
         internal int _run_token;
         internal DebugContext _context;
@@ -230,9 +93,7 @@ namespace openocd.Debugger
 
         public virtual void _reset_cache()
         {
-            this._cache = new Dictionary<object, object>
-            {
-            };
+            this._cache = new Dictionary<sbyte, UInt32>();
             this._metrics = new CacheMetrics();
         }
 
@@ -285,7 +146,7 @@ namespace openocd.Debugger
 
         public virtual List<UInt32> readCoreRegistersRaw(List<string> reg_list_s)
         {
-            object v;
+            UInt32 v;
             this._check_cache();
             List<sbyte> reg_list = this._convert_and_check_registers(reg_list_s);
             var reg_set = new HashSet<sbyte>(reg_list);
@@ -295,16 +156,22 @@ namespace openocd.Debugger
             // Read uncached registers from the target.
             List<sbyte> read_list = reg_set.Except(cached_set).ToList();
             bool reading_cfbp = read_list.Where(r => this.CFBP_REGS.Contains(r)).Any();
+            int cfbp_index = -1;
             if (reading_cfbp)
             {
                 if (!read_list.Contains(CortexM.CORE_REGISTER["cfbp"]))
                 {
                     read_list.Add(CortexM.CORE_REGISTER["cfbp"]);
                 }
-                var cfbp_index = read_list.IndexOf(CortexM.CORE_REGISTER["cfbp"]);
+                cfbp_index = read_list.IndexOf(CortexM.CORE_REGISTER["cfbp"]);
             }
             this._metrics.misses += (UInt32)read_list.Count;
-            var values = this._context.readCoreRegistersRaw(read_list);
+            List<UInt32> values = new List<UInt32>();
+            if (read_list.Count > 0)
+            {
+                List<string> read_names = read_list.Select(r => CortexM.CORE_REGISTER.First(kv => kv.Value == r).Key).ToList();
+                values = this._context.readCoreRegistersRaw(read_names);
+            }
             // Update all CFBP based registers.
             if (reading_cfbp)
             {
@@ -316,7 +183,7 @@ namespace openocd.Debugger
                     {
                         continue;
                     }
-                    this._cache[r] = v >> (-r - 1) * 8 & 0xFF;
+                    this._cache[r] = v >> ((-r - 1) * 8) & 0xFF;
                 }
             }
             // Build the results list in the same order as requested registers.
@@ -368,7 +235,7 @@ namespace openocd.Debugger
                 }
             }
             // Write new register values to target.
-            this._context.writeCoreRegistersRaw(reg_list, data_list);
+            this._context.writeCoreRegistersRaw(reg_list_s, data_list);
         }
 
         public virtual void invalidate()
@@ -377,27 +244,89 @@ namespace openocd.Debugger
         }
     }
 
+    //#
+    // @brief Memory cache made of fixed size blocks.
+    //
+    // Cached data lives in one contiguous arena of BLOCK_SIZE byte blocks. The index maps
+    // the number of an aligned block of target memory to its slot in the arena, so finding
+    // the cached parts of an access costs one lookup per block no matter how many accesses
+    // the session has cached. Each block has a bit per byte telling which bytes are valid.
     public class MemoryCache
     {
+        public const int BLOCK_SHIFT = 6;
+        public const UInt32 BLOCK_SIZE = 1 << BLOCK_SHIFT;
+        internal const UInt32 BLOCK_MASK = BLOCK_SIZE - 1;
+        internal const int INITIAL_BLOCKS = 64;
+        // Default arena limit, 1 MB. The cache is cleared when it would grow past it.
+        public const int MAX_BLOCKS = 16384;
+        // Cached runs shorter than this between two uncached runs are read again, one
+        // transfer costs more than re-reading a few bytes.
+        internal const UInt32 COALESCE_GAP = 32;
+
         internal DebugContext _context;
         internal int _run_token;
-        internal RangeTree.RangeTree<UInt32, RangeItem> _cache;
         internal CacheMetrics _metrics;
+        // Block number (address >> BLOCK_SHIFT) to arena slot
+        internal Dictionary<UInt32, int> _index;
+        internal byte[] _arena;
+        // Valid bytes of each slot, bit n for byte n of the block
+        internal UInt64[] _valid;
+        internal int _block_count;
+        internal readonly int _max_blocks;
 
-        public MemoryCache(DebugContext context)
+        public MemoryCache(DebugContext context, int max_blocks = MAX_BLOCKS)
         {
             this._context = context;
             this._run_token = -1;
+            this._max_blocks = max_blocks;
             //this._log = logging.getLogger("memcache");
             this._reset_cache();
         }
 
         public virtual void _reset_cache()
         {
-            this._cache = new RangeTree.RangeTree<UInt32, RangeItem>(new RangeItemComparer());
+            this._clear_blocks();
             this._metrics = new CacheMetrics();
         }
 
+        internal void _clear_blocks()
+        {
+            int blocks = Math.Min(INITIAL_BLOCKS, this._max_blocks);
+            this._index = new Dictionary<UInt32, int>();
+            this._arena = new byte[blocks * BLOCK_SIZE];
+            this._valid = new UInt64[blocks];
+            this._block_count = 0;
+        }
+
+        //#
+        // @brief Makes room for a range about to be stored, clearing the cache when it is full.
+        // @return False if the range alone spans more than the cache holds, it must not be stored.
+        internal bool _reserve(UInt32 addr, UInt32 size)
+        {
+            UInt64 first = addr >> BLOCK_SHIFT;
+            UInt64 blocks = (((UInt64)addr + size - 1) >> BLOCK_SHIFT) - first + 1;
+            if ((UInt64)this._block_count + blocks <= (UInt64)this._max_blocks)
+            {
+                return true;
+            }
+            // Only blocks not cached yet take new slots
+            UInt64 missing = 0;
+            for (UInt64 block = first; block < first + blocks; block++)
+            {
+                if (!this._index.ContainsKey((UInt32)block))
+                {
+                    missing += 1;
+                }
+            }
+            if ((UInt64)this._block_count + missing <= (UInt64)this._max_blocks)
+            {
+                return true;
+            }
+            Trace.TraceInformation("{0} blocks cached; clearing cache", this._block_count);
+            this._clear_blocks();
+            return blocks <= (UInt64)this._max_blocks;
+        }
+
         //#
         // @brief Invalidates the cache if appropriate.
         public virtual void _check_cache()
@@ -417,79 +346,159 @@ namespace openocd.Debugger
         }
 
         //#
-        // @brief Splits a memory address range into cached and uncached subranges.
-        // @return Returns a 2-tuple with the first element being a set of Interval objects for each
-        //   of the cached subranges. The second element is a set of Interval objects for each of the
-        //   non-cached subranges.
-        public virtual Tuple<HashSet<RangeItem>, HashSet<RangeItem>> _get_ranges(UInt32 addr, UInt32 count)
+        // @brief Mask of the bytes of a block that fall into [begin, end).
+        //
+        // @param begin Offset of the first byte in the block.
+        // @param end Offset after the last byte in the block, at most BLOCK_SIZE.
+        internal static UInt64 _block_mask(UInt32 begin, UInt32 end)
         {
-            HashSet<RangeItem> cached = new HashSet<RangeItem>(this._cache.Query(new RangeItem(addr, addr + count).Range));
-            HashSet<RangeItem> uncached = new HashSet<RangeItem>() {
-                    {
-                        new RangeItem(addr, addr + count)}
-                    };
-            foreach (RangeItem cachedIv in cached)
+            UInt64 upper = end == BLOCK_SIZE ? UInt64.MaxValue : (1UL << (int)end) - 1;
+            return upper & ~((1UL << (int)begin) - 1);
+        }
+
+        //#
+        // @return The arena slot of the block containing addr, or -1 if it is not cached.
+        internal int _find_block(UInt32 addr)
+        {
+            int slot;
+            return this._index.TryGetValue(addr >> BLOCK_SHIFT, out slot) ? slot : -1;
+        }
+
+        //#
+        // @return The arena slot of the block containing addr, allocated if needed.
+        internal int _get_block(UInt32 addr)
+        {
+            int slot;
+            if (this._index.TryGetValue(addr >> BLOCK_SHIFT, out slot))
             {
-                var newUncachedSet = new HashSet<RangeItem> ();
-                foreach (var uncachedIv in uncached)
+                return slot;
+            }
+            if (this._block_count == this._valid.Length)
+            {
+                int blocks = Math.Min(this._valid.Length * 2, this._max_blocks);
+                Array.Resize(ref this._arena, blocks * (int)BLOCK_SIZE);
+                Array.Resize(ref this._valid, blocks);
+            }
+            slot = this._block_count;
+            this._block_count += 1;
+            this._index.Add(addr >> BLOCK_SHIFT, slot);
+            return slot;
+        }
+
+        //#
+        // @brief Splits a memory address range into cached and uncached subranges.
+        // @return The uncached subranges as (address, size) pairs sorted by address. Uncached
+        //   ranges separated by less than COALESCE_GAP cached bytes are merged into one.
+        //
+        // Positions are 64 bit so a range may end at the top of the address space.
+        public virtual List<Tuple<UInt32, UInt32>> _get_uncached(UInt32 addr, UInt32 size, out UInt32 cachedSize)
+        {
+            List<Tuple<UInt32, UInt32>> uncached = new List<Tuple<UInt32, UInt32>>();
+            UInt64 end = (UInt64)addr + size;
+            UInt64 runBegin = 0;
+            UInt64 runEnd = 0;
+            bool inRun = false;
+            cachedSize = 0;
+            UInt64 pos = addr;
+            while (pos < end)
+            {
+                UInt64 blockBase = pos & ~(UInt64)BLOCK_MASK;
+                UInt32 blockEnd = (UInt32)Math.Min(end - blockBase, BLOCK_SIZE);
+                UInt32 offset = (UInt32)(pos - blockBase);
+                int slot = this._find_block((UInt32)pos);
+                UInt64 wanted = _block_mask(offset, blockEnd);
+                UInt64 missing = slot < 0 ? wanted : wanted & ~this._valid[slot];
+                if (missing == wanted)
                 {
-                    // No overlap.
-                    if (cachedIv.Range.To < uncachedIv.Range.From || cachedIv.Range.From > uncachedIv.Range.To)
+                    // Whole part of this block is missing
+                    if (!inRun || pos - runEnd >= COALESCE_GAP)
                     {
-                        newUncachedSet.Add(uncachedIv);
-                        continue;
-                    }
-                    // Begin segment.
-                    if (cachedIv.Range.From - uncachedIv.Range.From > 0)
-                    {
-                        newUncachedSet.Add(new RangeItem(uncachedIv.Range.From, cachedIv.Range.From));
+                        if (inRun)
+                        {
+                            uncached.Add(Tuple.Create((UInt32)runBegin, (UInt32)(runEnd - runBegin)));
+                        }
+                        runBegin = pos;
+                        inRun = true;
                     }
-                    // End segment.
-                    if (uncachedIv.Range.To - cachedIv.Range.To > 0)
+                    runEnd = blockBase + blockEnd;
+                }
+                else
+                {
+                    for (UInt32 i = offset; i < blockEnd; i++)
                     {
-                        newUncachedSet.Add(new RangeItem(cachedIv.Range.To, uncachedIv.Range.To));
+                        if ((missing & (1UL << (int)i)) == 0)
+                        {
+                            cachedSize += 1;
+                            continue;
+                        }
+                        UInt64 byteAddr = blockBase + i;
+                        if (!inRun || byteAddr - runEnd >= COALESCE_GAP)
+                        {
+                            if (inRun)
+                            {
+                                uncached.Add(Tuple.Create((UInt32)runBegin, (UInt32)(runEnd - runBegin)));
+                            }
+                            runBegin = byteAddr;
+                            inRun = true;
+                        }
+                        runEnd = byteAddr + 1;
                     }
                 }
-                uncached = newUncachedSet;
+                pos = blockBase + blockEnd;
+            }
+            if (inRun)
+            {
+                uncached.Add(Tuple.Create((UInt32)runBegin, (UInt32)(runEnd - runBegin)));
             }
-            return Tuple.Create(cached, uncached);
+            return uncached;
         }
 
         //#
-        // @brief Reads uncached memory ranges and updates the cache.
-        // @return A list of Interval objects is returned. Each Interval has its @a data attribute set
-        //   to a bytearray of the data read from target memory.
-        public virtual object _read_uncached(HashSet<RangeItem> uncached)
+        // @brief Copies data into the cache and marks it valid.
+        internal void _store(UInt32 addr, List<byte> data)
         {
-            var uncachedData = new List<object>();
-            foreach (var uncachedIv in uncached)
+            UInt64 end = (UInt64)addr + (UInt32)data.Count;
+            UInt64 pos = addr;
+            int index = 0;
+            while (pos < end)
             {
-                List<byte> data = this._context.readBlockMemoryUnaligned8(uncachedIv.Range.From, uncachedIv.Range.To - uncachedIv.Range.From);
-                var iv = new RangeItem(uncachedIv.Range.From, uncachedIv.Range.To, data);
-                this._cache.Add(iv);
-                uncachedData.Add(iv);
+                UInt64 blockBase = pos & ~(UInt64)BLOCK_MASK;
+                UInt32 blockEnd = (UInt32)Math.Min(end - blockBase, BLOCK_SIZE);
+                UInt32 offset = (UInt32)(pos - blockBase);
+                int slot = this._get_block((UInt32)pos);
+                int count = (int)(blockEnd - offset);
+                data.CopyTo(index, this._arena, slot * (int)BLOCK_SIZE + (int)offset, count);
+                this._valid[slot] |= _block_mask(offset, blockEnd);
+                index += count;
+                pos = blockBase + blockEnd;
             }
-            return uncachedData;
         }
 
-        public virtual void _update_metrics(HashSet<RangeItem> cached, HashSet<RangeItem> uncached, UInt32 addr, UInt32 size)
-        {
-            var cachedSize = 0;
-            foreach (var iv in cached)
-            {
-                var begin = iv.From;
-                var end = iv.To;
-                if (iv.From < addr)
-                {
-                    begin = addr;
-                }
-                if (iv.To > addr + size)
-                {
-                    end = addr + size;
-                }
-                cachedSize += end - begin;
+        //#
+        // @brief Copies fully cached data out of the cache.
+        internal byte[] _load(UInt32 addr, UInt32 size)
+        {
+            byte[] result = new byte[size];
+            UInt64 end = (UInt64)addr + size;
+            UInt64 pos = addr;
+            int index = 0;
+            while (pos < end)
+            {
+                UInt64 blockBase = pos & ~(UInt64)BLOCK_MASK;
+                UInt32 blockEnd = (UInt32)Math.Min(end - blockBase, BLOCK_SIZE);
+                UInt32 offset = (UInt32)(pos - blockBase);
+                int slot = this._find_block((UInt32)pos);
+                int count = (int)(blockEnd - offset);
+                Debug.Assert(slot >= 0 && (this._valid[slot] & _block_mask(offset, blockEnd)) == _block_mask(offset, blockEnd));
+                Buffer.BlockCopy(this._arena, slot * (int)BLOCK_SIZE + (int)offset, result, index, count);
+                index += count;
+                pos = blockBase + blockEnd;
             }
-            var uncachedSize = uncached.Select(iv => iv.To - iv.From).Sum();
+            return result;
+        }
+
+        public virtual void _update_metrics(UInt32 cachedSize, UInt32 uncachedSize)
+        {
             this._metrics.reads += 1;
             this._metrics.hits += cachedSize;
             this._metrics.misses += uncachedSize;
@@ -499,7 +508,8 @@ namespace openocd.Debugger
         {
             if (this._metrics.total > 0)
             {
-                Trace.TraceInformation("%d reads, %d bytes [%d%% hits, %d bytes]; %d bytes written", this._metrics.reads, this._metrics.total, this._metrics.percent_hit, this._metrics.hits, this._metrics.writes);
+                Trace.TraceInformation("{0} reads, {1} bytes [{2:0}% hits, {3} bytes]; {4} bytes written; {5} blocks",
+                    this._metrics.reads, this._metrics.total, this._metrics.percent_hit, this._metrics.hits, this._metrics.writes, this._block_count);
             }
             else
             {
@@ -509,90 +519,26 @@ namespace openocd.Debugger
 
         //#
         // @brief Performs a cached read operation of an address range.
-        // @return A list of Interval objects sorted by address.
-        public virtual object _read(UInt32 addr, UInt32 size)
-        {
-            // Get the cached and uncached subranges of the requested read.
-            var _tup_1 = this._get_ranges(addr, size);
-            var cached = _tup_1.Item1;
-            var uncached = _tup_1.Item2;
-            this._update_metrics(cached, uncached, addr, size);
-            // Read any uncached ranges.
-            var uncachedData = this._read_uncached(uncached);
-            // Merged cached with data we just read
-            var combined = cached.ToList() + uncachedData;
-            combined.sort(key: x => x.begin);
-            return combined;
-        }
-
-        //#
-        // @brief Extracts data from the intersection of an address range across a list of interval objects.
         //
-        // The range represented by @a addr and @a size are assumed to overlap the intervals. The first
-        // and last interval in the list may have ragged edges not fully contained in the address range, in
-        // which case the correct slice of those intervals is extracted.
-        //
-        // @param self
-        // @param combined List of Interval objects forming a contiguous range. The @a data attribute of
-        //   each interval must be a bytearray.
-        // @param addr Start address. Must be within the range of the first interval.
-        // @param size Number of bytes. (@a addr + @a size) must be within the range of the last interval.
-        // @return A single bytearray object with all data from the intervals that intersects the address
-        //   range.
-        public virtual List<byte> _merge_data(object combined, object addr, object size)
-        {
-            object offset;
-            var result = bytearray();
-            var resultAppend = bytearray();
-            // Take slice of leading ragged edge.
-            if (combined.Count && combined[0].begin < addr)
-            {
-                offset = addr - combined[0].begin;
-                result += combined[0].data[offset];
-                combined = combined[1];
-            }
-            // Take slice of trailing ragged edge.
-            if (combined.Count && combined[-1].end > addr + size)
-            {
-                offset = addr + size - combined[-1].begin;
-                resultAppend = combined[-1].data[::offset];
-                combined = combined[:: - 1];
-            }
-            // Merge.
-            foreach (var iv in combined)
-            {
-                result += iv.data;
-            }
-            result += resultAppend;
-            return result;
-        }
-
-        //#
-        // @brief
-        public virtual void _update_contiguous(object cached, UInt32 addr, List<object> value)
+        // Reads the uncached subranges from the target, adds them to the cache and returns
+        // the whole range from the cache.
+        public virtual byte[] _read(UInt32 addr, UInt32 size)
         {
-            object offset;
-            var size = value.Count;
-            var end = addr + size;
-            var leadBegin = addr;
-            var leadData = bytearray();
-            var trailData = bytearray();
-            var trailEnd = end;
-            if (cached[0].begin < addr && cached[0].end > addr)
+            if (!this._reserve(addr, size))
             {
-                offset = addr - cached[0].begin;
-                leadData = cached[0].data[::offset];
-                leadBegin = cached[0].begin;
+                // Larger than the whole cache, read around it
+                this._update_metrics(0, size);
+                return this._context.readBlockMemoryUnaligned8(addr, size).ToArray();
             }
-            if (cached[-1].begin < end && cached[-1].end > end)
+            UInt32 cachedSize;
+            List<Tuple<UInt32, UInt32>> uncached = this._get_uncached(addr, size, out cachedSize);
+            this._update_metrics(cachedSize, size - cachedSize);
+            foreach (var iv in uncached)
             {
-                offset = end - cached[-1].begin;
-                trailData = cached[-1].data[offset];
-                trailEnd = cached[-1].end;
+                List<byte> data = this._context.readBlockMemoryUnaligned8(iv.Item1, iv.Item2);
+                this._store(iv.Item1, data);
             }
-            this._cache.remove_overlap(addr, end);
-            var data = leadData + value + trailData;
-            this._cache.addi(leadBegin, trailEnd, data);
+            return this._load(addr, size);
         }
 
         //#
@@ -619,7 +565,7 @@ namespace openocd.Debugger
         public virtual object readMemory(UInt32 addr, byte transfer_size = 32, bool now = true)
         {
             // TODO use more optimal underlying readMemory call
-            object data;
+            UInt32 data;
             if (transfer_size == 8)
             {
                 data = this.readBlockMemoryUnaligned8(addr, 1)[0];
@@ -642,7 +588,7 @@ namespace openocd.Debugger
             }
             else
             {
-                Func<object> read_cb = () =>
+                Func<UInt32> read_cb = () =>
                 {
                     return data;
                 };
@@ -660,14 +606,11 @@ namespace openocd.Debugger
             // Validate memory regions.
             if (!this._check_regions(addr, size))
             {
-                Trace.TraceInformation("range [%x:%x] is not cacheable", addr, addr + size);
+                Trace.TraceInformation("range [{0:X}:{1:X}] is not cacheable", addr, addr + size);
                 return this._context.readBlockMemoryUnaligned8(addr, size);
             }
-            // Get the cached and uncached subranges of the requested read.
-            var combined = this._read(addr, size);
-            // Extract data out of combined intervals.
-            List<byte> result = this._merge_data(combined, addr, size).ToList();
-            return result;
+            // Read the uncached subranges and take the whole range from the cache.
+            return this._read(addr, size).ToList();
         }
 
         public virtual List<UInt32> readBlockMemoryAligned32(UInt32 addr, UInt32 size)
@@ -712,31 +655,11 @@ namespace openocd.Debugger
             var cacheable = this._check_regions(addr, (UInt32)value.Count);
             // Write to the target first, so if it fails we don't update the cache.
             this._context.writeBlockMemoryUnaligned8(addr, value);
-            if (cacheable)
+            if (cacheable && this._reserve(addr, (UInt32)value.Count))
             {
-                var size = value.Count;
-                var end = addr + size;
-                var cached = this._cache.search(addr, end).OrderBy(x => x.begin).ToList();
-                this._metrics.writes += (UInt32)size;
-                if (cached.Any())
-                {
-                    // Write data is entirely within cached data.
-                    if (addr >= cached[0].begin && end <= cached[0].end)
-                    {
-                        var beginOffset = addr - cached[0].begin;
-                        var endOffset = end - cached[0].end;
-                        cached[0].data.GetRange(beginOffset, endOffset - beginOffset) = value;
-                    }
-                    else
-                    {
-                        this._update_contiguous(cached, addr, value);
-                    }
-                }
-                else
-                {
-                    // No cached data in this range, so just add the entire interval.
-                    this._cache.addi(addr, end, value);
-                }
+                // Written data is known, so it is cached whether or not it was before.
+                this._metrics.writes += (UInt32)value.Count;
+                this._store(addr, value);
             }
         }
 
@@ -798,7 +721,7 @@ namespace openocd.Debugger
             return this._regcache.readCoreRegistersRaw(reg_list);
         }
 
-        public virtual void writeCoreRegistersRaw(List<string> reg_list, List<UInt32> data_list)
+        public override void writeCoreRegistersRaw(List<string> reg_list, List<UInt32> data_list)
         {
             this._regcache.writeCoreRegistersRaw(reg_list, data_list);
         }
@@ -17,6 +17,16 @@ namespace openocd.Flash
     {
         public readonly ITarget target;
         private Dictionary<string, object> flash_algo;
+        private FlashAlgoHeader algo_header;
+        private FlashDevice flash_device;
+        private bool analyzer_supported;
+        private UInt32 cpu_clock;
+        private bool cpu_clock_known;
+        private double page_erase_weight;
+        private double page_program_weight;
+        private double chip_erase_weight;
+        private double sector_erase_rate;
+        private FlashAlgoStats host_stats;
         private bool flash_algo_debug;
         private UInt32? end_flash_algo;
         private UInt32? begin_stack;
@@ -32,13 +42,36 @@ namespace openocd.Flash
             this.target = target;
             this.flash_algo = flash_algo;
             this.flash_algo_debug = false;
+            this.page_erase_weight = FlashConsts.DEFAULT_PAGE_ERASE_WEIGHT;
+            this.page_program_weight = FlashConsts.DEFAULT_PAGE_PROGRAM_WEIGHT;
+            this.chip_erase_weight = FlashConsts.DEFAULT_CHIP_ERASE_WEIGHT;
+            this.host_stats = new FlashAlgoStats();
             if (flash_algo != null)
             {
-                this.end_flash_algo = (UInt32)((UInt32)flash_algo["load_address"] + flash_algo.Count * 4);
-                this.begin_stack = (UInt32)flash_algo["begin_stack"];
-                this.begin_data = (UInt32)flash_algo["begin_data"];
-                this.static_base = (UInt32)flash_algo["static_base"];
+                UInt32 load_address = (UInt32)flash_algo["load_address"];
+                this.end_flash_algo = (UInt32)(load_address + flash_algo.Count * 4);
+                // Images with a dispatch header describe their own RAM layout
+                this.algo_header = FlashAlgoHeader.parse((List<UInt32>)flash_algo["instructions"]);
+                this.flash_device = FlashDevice.find((List<UInt32>)flash_algo["instructions"]);
+                if (this.algo_header != null)
+                {
+                    this.begin_stack = load_address + this.algo_header.stack;
+                    this.begin_data = load_address + this.algo_header.data;
+                    this.static_base = load_address + this.algo_header.static_base;
+                    this.analyzer_supported = this.algo_header.hasCapability(FlashAlgoHeader.ALGO_CAP_COMPUTE_CRC);
+                }
+                else
+                {
+                    this.begin_stack = (UInt32)flash_algo["begin_stack"];
+                    this.begin_data = (UInt32)flash_algo["begin_data"];
+                    this.static_base = (UInt32)flash_algo["static_base"];
+                    this.analyzer_supported = (bool)flash_algo["analyzer_supported"];
+                }
                 this.min_program_length = flash_algo.ContainsKey("min_program_length") ? (UInt32)flash_algo["min_program_length"] : 0;
+                // The core may run from a PLL set up by the application, so the
+                // default clock is only good enough to format the counters
+                this.cpu_clock_known = flash_algo.ContainsKey("cpu_clock");
+                this.cpu_clock = this.cpu_clock_known ? (UInt32)flash_algo["cpu_clock"] : FlashConsts.DEFAULT_CPU_CLOCK;
                 // Check for double buffering support.
                 if (flash_algo.ContainsKey("page_buffers"))
                 {
@@ -77,7 +110,7 @@ namespace openocd.Flash
             this.target.halt();
             this.target.setTargetState(ETargetState.TARGET_PROGRAM);
             // update core register to execute the init subroutine
-            UInt32 result = this.callFunctionAndWait((UInt32)this.flash_algo["pc_init"], init: true);
+            UInt32 result = this.callAlgoAndWait("pc_init", init: true);
             // check the return code
             if (result != 0)
             {
@@ -105,7 +138,7 @@ namespace openocd.Flash
             }
             this.target.writeBlockMemoryAligned32((UInt32)this.begin_data, data);
             // update core register to execute the subroutine
-            var result = this.callFunctionAndWait((UInt32)this.flash_algo["analyzer_address"], this.begin_data, (UInt32)data.Count);
+            var result = this.callAlgoAndWait("analyzer_address", this.begin_data, (UInt32)data.Count);
             // Read back the CRCs for each section
             data = this.target.readBlockMemoryAligned32((UInt32)this.begin_data, (UInt32)data.Count);
             return data;
@@ -117,7 +150,7 @@ namespace openocd.Flash
         public virtual void eraseAll()
         {
             // update core register to execute the eraseAll subroutine
-            UInt32 result = this.callFunctionAndWait((UInt32)this.flash_algo["pc_eraseAll"]);
+            UInt32 result = this.callAlgoAndTime(this.host_stats.erase_chip, 0, "pc_eraseAll");
             // check the return code
             if (result != 0)
             {
@@ -131,7 +164,7 @@ namespace openocd.Flash
         public virtual void erasePage(UInt32 flashPtr)
         {
             // update core register to execute the erasePage subroutine
-            UInt32 result = this.callFunctionAndWait((UInt32)this.flash_algo["pc_erase_sector"], flashPtr);
+            UInt32 result = this.callAlgoAndTime(this.host_stats.erase_sector, this.getEraseSize(flashPtr), "pc_erase_sector", flashPtr);
             // check the return code
             if (result != 0)
             {
@@ -146,12 +179,22 @@ namespace openocd.Flash
         {
             // prevent security settings from locking the device
             bytes = this.overrideSecurityBits(flashPtr, bytes);
+            // the page is erased, so trailing erased words don't need to be transferred
+            // to an algorithm that accepts partial pages
+            if (this.isPartialPageSupported())
+            {
+                bytes = FlashBuilderConsts._strip_erased_tail(bytes, (int)Math.Max(4U, this.min_program_length ?? 0));
+                if (bytes.Count == 0)
+                {
+                    return;
+                }
+            }
             // first transfer in RAM
             this.target.writeBlockMemoryUnaligned8((UInt32)this.begin_data, bytes);
             // get info about this page
             var page_info = this.getPageInfo(flashPtr);
             // update core register to execute the program_page subroutine
-            UInt32 result = this.callFunctionAndWait((UInt32)this.flash_algo["pc_program_page"], flashPtr, (UInt32)bytes.Count, this.begin_data);
+            UInt32 result = this.callAlgoAndTime(this.host_stats.program_page, (UInt32)bytes.Count, "pc_program_page", flashPtr, (UInt32)bytes.Count, this.begin_data);
             // check the return code
             if (result != 0)
             {
@@ -159,6 +202,69 @@ namespace openocd.Flash
             }
         }
 
+        // 
+        //         Flash one page from a slice of the image
+        // 
+        //         Only the bytes sent to the target are copied.
+        //         
+        public virtual void programPage(UInt32 flashPtr, ArraySegment<byte> bytes)
+        {
+            if (this.isPartialPageSupported())
+            {
+                bytes = FlashBuilderConsts._strip_erased_tail(bytes, (int)Math.Max(4U, this.min_program_length ?? 0));
+                if (bytes.Count == 0)
+                {
+                    return;
+                }
+            }
+            this.programPage(flashPtr, new List<byte>(bytes));
+        }
+
+        // 
+        //         Whether ProgramPage takes any multiple of the program unit and skips
+        //         erased words, so a page can be programmed without an erase
+        //         
+        public virtual bool isPartialPageSupported()
+        {
+            return this.algo_header != null && this.algo_header.hasCapability(FlashAlgoHeader.ALGO_CAP_PARTIAL_PAGE);
+        }
+
+        public virtual bool isProgramFillSupported()
+        {
+            return this.hasAlgoFunction("pc_program_fill");
+        }
+
+        // 
+        //         Fill erased flash with a repeated 32-bit pattern
+        // 
+        //         No data is transferred when the flash algorithm has a fill entry point.
+        //         
+        public virtual void programFill(UInt32 flashPtr, UInt32 length, UInt32 pattern)
+        {
+            // erased flash already holds the pattern
+            if (pattern == 0xFFFFFFFF)
+            {
+                return;
+            }
+            if (!this.isProgramFillSupported())
+            {
+                List<byte> bytes = new List<byte>((int)length);
+                for (int i = 0; i < length; i++)
+                {
+                    bytes.Add((byte)((pattern >> (8 * (i % 4))) & 0xFF));
+                }
+                this.programPage(flashPtr, bytes);
+                return;
+            }
+            // update core register to execute the program_fill subroutine
+            UInt32 result = this.callAlgoAndTime(this.host_stats.program_fill, length, "pc_program_fill", flashPtr, length, pattern);
+            // check the return code
+            if (result != 0)
+            {
+                Trace.TraceError("programFill(0x{0:X}) error: {1:X}", flashPtr, result);
+            }
+        }
+
         public virtual UInt32 getPageBufferCount()
         {
             return (UInt32)this.page_buffers.Count;
@@ -179,7 +285,7 @@ namespace openocd.Flash
             var page_info = this.getPageInfo(flashPtr);
             // update core register to execute the program_page subroutine
             //var result = 
-            this.callFunction((UInt32)this.flash_algo["pc_program_page"], flashPtr, page_info.size, this.page_buffers[(int)bufferNumber]);
+            this.callAlgo("pc_program_page", flashPtr, page_info.size, this.page_buffers[(int)bufferNumber]);
         }
 
         public virtual void loadPageBuffer(UInt32 bufferNumber, UInt32 flashPtr, List<byte> bytes)
@@ -220,7 +326,7 @@ namespace openocd.Flash
             // first transfer in RAM
             this.target.writeBlockMemoryUnaligned8((UInt32)this.begin_data, bytes);
             // update core register to execute the program_page subroutine
-            UInt32 result = this.callFunctionAndWait((UInt32)this.flash_algo["pc_program_page"], flashPtr, (UInt32)bytes.Count, this.begin_data);
+            UInt32 result = this.callAlgoAndWait("pc_program_page", flashPtr, (UInt32)bytes.Count, this.begin_data);
             // check the return code
             if (result != 0)
             {
@@ -242,8 +348,8 @@ namespace openocd.Flash
             }
             FlashConsts.PageInfo info = new FlashConsts.PageInfo
             {
-                erase_weight = FlashConsts.DEFAULT_PAGE_ERASE_WEIGHT,
-                program_weight = FlashConsts.DEFAULT_PAGE_PROGRAM_WEIGHT,
+                erase_weight = this.sector_erase_rate > 0 ? this.sector_erase_rate * region.blocksize : this.page_erase_weight,
+                program_weight = this.page_program_weight,
                 size = region.blocksize
             };
             info.base_addr = addr - addr % info.size;
@@ -261,12 +367,98 @@ namespace openocd.Flash
             FlashConsts.FlashInfo info = new FlashConsts.FlashInfo
             {
                 rom_start = boot_region != null ? boot_region.start : 0,
-                erase_weight = FlashConsts.DEFAULT_CHIP_ERASE_WEIGHT,
-                crc_supported = (bool)this.flash_algo["analyzer_supported"]
+                erase_weight = this.chip_erase_weight,
+                crc_supported = this.analyzer_supported
             };
             return info;
         }
 
+        // 
+        //         Get the sector geometry from the device description in the algorithm
+        // 
+        //         Returns null if the algorithm has none.
+        //         
+        public virtual FlashDevice getFlashDevice()
+        {
+            return this.flash_device;
+        }
+
+        public virtual bool isStatsSupported()
+        {
+            return this.algo_header != null && this.algo_header.hasCapability(FlashAlgoHeader.ALGO_CAP_STATS);
+        }
+
+        public virtual UInt32 getCpuClock()
+        {
+            return this.cpu_clock;
+        }
+
+        // 
+        //         Read and clear the performance counters of the flash algorithm
+        // 
+        //         Returns null if the algorithm does not record them.
+        //         
+        public virtual FlashAlgoStats readStats()
+        {
+            if (!this.isStatsSupported())
+            {
+                return null;
+            }
+            List<UInt32> words = this.target.readBlockMemoryAligned32((UInt32)this.static_base, FlashAlgoStats.WORD_COUNT);
+            FlashAlgoStats stats = FlashAlgoStats.parse(words);
+            if (stats == null)
+            {
+                return null;
+            }
+            // keep the version word, zero the counters
+            this.target.writeBlockMemoryAligned32(
+                (UInt32)this.static_base + FlashAlgoStats.HEADER_WORDS * 4,
+                Enumerable.Repeat<UInt32>(0, FlashAlgoStats.WORD_COUNT - FlashAlgoStats.HEADER_WORDS).ToList());
+            return stats;
+        }
+
+        // 
+        //         Estimated time to erase a sector of the given size in seconds
+        // 
+        public virtual double getSectorEraseWeight(UInt32 size)
+        {
+            return this.sector_erase_rate > 0 ? this.sector_erase_rate * size : this.page_erase_weight;
+        }
+
+        // 
+        //         Replace the default erase and program weights with measured times
+        // 
+        //         The weights are seconds per operation, as used by FlashBuilder to
+        //         choose between chip erase and page erase. Cycle counts only convert
+        //         to seconds when the target supplies its cpu_clock, otherwise the host
+        //         timings of the same calls are used, which include the probe overhead.
+        //         Erase times are kept per byte, since sectors can be much larger than
+        //         the pages the weights are otherwise given for.
+        //         
+        public virtual void calibrate(FlashAlgoStats stats)
+        {
+            UInt32 clock = this.cpu_clock;
+            if (stats == null || !this.cpu_clock_known)
+            {
+                stats = this.host_stats;
+                clock = FlashAlgoStats.HOST_CLOCK;
+            }
+            // Only the host knows the size of the erased sectors
+            if (stats.erase_sector.calls > 0 && this.host_stats.erase_sector.bytes > 0)
+            {
+                this.sector_erase_rate = (double)stats.erase_sector.cycles / clock / this.host_stats.erase_sector.bytes;
+            }
+            if (stats.program_page.calls > 0)
+            {
+                this.page_program_weight = stats.program_page.getMeanLatency(clock);
+            }
+            if (stats.erase_chip.calls > 0)
+            {
+                this.chip_erase_weight = stats.erase_chip.getMeanLatency(clock);
+            }
+            this.host_stats = new FlashAlgoStats();
+        }
+
         public virtual FlashBuilder getFlashBuilder()
         {
             return new FlashBuilder(this, (UInt32)this.getFlashInfo().rom_start);
@@ -282,6 +474,17 @@ namespace openocd.Flash
             bool? chip_erase = null,
             Action<double> progress_cb = null,
             bool fast_verify = false)
+        {
+            return this.flashBlock(addr, new ArraySegment<byte>(data.ToArray()), smart_flash, chip_erase, progress_cb, fast_verify);
+        }
+
+        public virtual object flashBlock(
+            UInt32 addr,
+            ArraySegment<byte> data,
+            bool smart_flash = true,
+            bool? chip_erase = null,
+            Action<double> progress_cb = null,
+            bool fast_verify = false)
         {
             UInt32 flash_start = (UInt32)this.getFlashInfo().rom_start;
             FlashBuilder fb = new FlashBuilder(this, flash_start);
@@ -312,10 +515,10 @@ namespace openocd.Flash
             // }
             // var data = unpack(str(data.Count) + "B", data);
             byte[] data = file_bytes; // File.ReadAllBytes(path_file);
-            this.flashBlock((UInt32)flashPtr, data.ToList(), smart_flash, chip_erase, progress_cb, fast_verify);
-            if (this.flash_algo.ContainsKey("pc_uninit"))
+            this.flashBlock((UInt32)flashPtr, new ArraySegment<byte>(data), smart_flash, chip_erase, progress_cb, fast_verify);
+            if (this.hasAlgoFunction("pc_uninit"))
             {
-                callFunctionAndWait((UInt32)this.flash_algo["pc_uninit"]);
+                this.callAlgoAndWait("pc_uninit");
             }
         }
 
@@ -350,7 +553,8 @@ namespace openocd.Flash
                     Debug.Assert(algo.SequenceEqual(vrfy));
                 }
 
-                if ((bool)this.flash_algo["analyzer_supported"])
+                // an image with a dispatch header already contains the analyzer
+                if (this.analyzer_supported && this.algo_header == null)
                 {
                     this.target.writeBlockMemoryAligned32(
                         (UInt32)this.flash_algo["analyzer_address"], 
@@ -428,9 +632,9 @@ namespace openocd.Flash
             // }
             if (this.flash_algo_debug)
             {
-                bool analyzer_supported = (bool)this.flash_algo["analyzer_supported"];
-                UInt32 expected_fp = (UInt32)this.flash_algo["static_base"];
-                UInt32 expected_sp = (UInt32)this.flash_algo["begin_stack"];
+                bool analyzer_supported = this.analyzer_supported && this.algo_header == null;
+                UInt32 expected_fp = (UInt32)this.static_base;
+                UInt32 expected_sp = (UInt32)this.begin_stack;
                 UInt32 expected_pc = (UInt32)this.flash_algo["load_address"];
                 var expected_flash_algo = this.flash_algo["instructions"];
                 if (analyzer_supported)
@@ -483,6 +687,73 @@ namespace openocd.Flash
             return this.target.readCoreRegister("r0");
         }
 
+        // 
+        //         Check if the flash algorithm implements an entry point
+        //         
+        public virtual bool hasAlgoFunction(string pc_key)
+        {
+            if (this.algo_header != null)
+            {
+                return this.algo_header.supports(pc_key);
+            }
+            return this.flash_algo.ContainsKey(pc_key);
+        }
+
+        // 
+        //         Call a flash algorithm entry point by its flash_algo key
+        // 
+        //         Images with a dispatch header have a single entry point which gets
+        //         the operation code in r3, legacy images have one address per key.
+        //         
+        public virtual void callAlgo(
+            string pc_key,
+            UInt32? r0 = null,
+            UInt32? r1 = null,
+            UInt32? r2 = null,
+            bool init = false)
+        {
+            if (this.algo_header != null)
+            {
+                UInt32 pc = (UInt32)this.flash_algo["load_address"] + this.algo_header.dispatch;
+                this.callFunction(pc, r0, r1, r2, FlashAlgoHeader.operations[pc_key], init);
+            }
+            else
+            {
+                this.callFunction((UInt32)this.flash_algo[pc_key], r0, r1, r2, null, init);
+            }
+        }
+
+        public virtual UInt32 callAlgoAndWait(
+            string pc_key,
+            UInt32? r0 = null,
+            UInt32? r1 = null,
+            UInt32? r2 = null,
+            bool init = false)
+        {
+            this.callAlgo(pc_key, r0, r1, r2, init);
+            return this.waitForCompletion();
+        }
+
+        // 
+        //         Call the algorithm and account the time it took in op
+        // 
+        private UInt32 callAlgoAndTime(FlashAlgoStats.OpStats op, UInt32 bytes, string pc_key, UInt32? r0 = null, UInt32? r1 = null, UInt32? r2 = null)
+        {
+            Stopwatch stopwatch = Stopwatch.StartNew();
+            UInt32 result = this.callAlgoAndWait(pc_key, r0, r1, r2);
+            op.add(bytes, (UInt64)(stopwatch.Elapsed.Ticks / (TimeSpan.TicksPerSecond / FlashAlgoStats.HOST_CLOCK)), result != 0);
+            return result;
+        }
+
+        // 
+        //         Bytes erased by an erase of the sector or page at addr
+        // 
+        private UInt32 getEraseSize(UInt32 addr)
+        {
+            FlashDevice.Sector sector = this.getFlashDevice() != null ? this.getFlashDevice().getSector(addr) : null;
+            return sector != null ? sector.size : (UInt32)this.getPageInfo(addr).size;
+        }
+
         public virtual UInt32 callFunctionAndWait(
             UInt32 pc,
             UInt32? r0 = null,
@@ -0,0 +1,135 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace openocd.Flash
+{
+    // 
+    //     Dispatch header at the start of a flash algorithm image
+    // 
+    //     Mirrors struct FlashAlgoHeader in Targets/FlashAlgo.h. All addresses are
+    //     offsets from the load address, so the image can be loaded anywhere in RAM.
+    // 
+    public class FlashAlgoHeader
+    {
+        public const UInt32 ALGO_MAGIC = 0x4F474C41;
+        public const UInt32 ALGO_VERSION = 1;
+
+        public const UInt32 ALGO_OP_INIT = 0;
+        public const UInt32 ALGO_OP_UNINIT = 1;
+        public const UInt32 ALGO_OP_ERASE_CHIP = 2;
+        public const UInt32 ALGO_OP_ERASE_SECTOR = 3;
+        public const UInt32 ALGO_OP_PROGRAM_PAGE = 4;
+        public const UInt32 ALGO_OP_PROGRAM_FILL = 5;
+        public const UInt32 ALGO_OP_COMPUTE_CRC = 6;
+
+        public const UInt32 ALGO_CAP_ERASE_CHIP = 0x00000001;
+        public const UInt32 ALGO_CAP_ERASE_SECTOR = 0x00000002;
+        public const UInt32 ALGO_CAP_PROGRAM_PAGE = 0x00000004;
+        public const UInt32 ALGO_CAP_PROGRAM_FILL = 0x00000008;
+        public const UInt32 ALGO_CAP_COMPUTE_CRC = 0x00000010;
+        public const UInt32 ALGO_CAP_STATS = 0x00000020;
+        public const UInt32 ALGO_CAP_PARTIAL_PAGE = 0x00000040;
+
+        // Header words, in image order
+        private const int WORD_TRAP = 0;
+        private const int WORD_MAGIC = 1;
+        private const int WORD_VERSION = 2;
+        private const int WORD_SIZE = 3;
+        private const int WORD_CAPS = 4;
+        private const int WORD_DISPATCH = 5;
+        private const int WORD_STATIC_BASE = 6;
+        private const int WORD_STACK = 7;
+        private const int WORD_DATA = 8;
+        private const int WORD_DATA_SIZE = 9;
+        private const int WORD_RAM_SIZE = 10;
+        private const int WORD_COUNT = 11;
+
+        // Operation codes of the legacy flash_algo entry point keys
+        public static readonly Dictionary<string, UInt32> operations = new Dictionary<string, UInt32>()
+        {
+            { "pc_init",          ALGO_OP_INIT },
+            { "pc_uninit",        ALGO_OP_UNINIT },
+            { "pc_eraseAll",      ALGO_OP_ERASE_CHIP },
+            { "pc_erase_sector",  ALGO_OP_ERASE_SECTOR },
+            { "pc_program_page",  ALGO_OP_PROGRAM_PAGE },
+            { "pc_program_fill",  ALGO_OP_PROGRAM_FILL },
+            { "analyzer_address", ALGO_OP_COMPUTE_CRC },
+        };
+
+        public UInt32 version;
+        public UInt32 caps;
+        public UInt32 dispatch;
+        public UInt32 static_base;
+        public UInt32 stack;
+        public UInt32 data;
+        public UInt32 data_size;
+        public UInt32 ram_size;
+
+        // 
+        //         Parse the header from the algorithm instructions
+        // 
+        //         Returns null for images without a dispatch header, throws for
+        //         headers of another version or size.
+        // 
+        public static FlashAlgoHeader parse(List<UInt32> instructions)
+        {
+            if (instructions.Count < WORD_COUNT || instructions[WORD_MAGIC] != ALGO_MAGIC)
+            {
+                return null;
+            }
+            // A newer layout may move the words read below
+            UInt32 version = instructions[WORD_VERSION];
+            if (version != ALGO_VERSION)
+            {
+                throw new Exception(String.Format("Unsupported flash algorithm header version {0}", version));
+            }
+            if (instructions[WORD_SIZE] < WORD_COUNT * 4)
+            {
+                throw new Exception(String.Format("Truncated flash algorithm header of {0} bytes", instructions[WORD_SIZE]));
+            }
+            FlashAlgoHeader header = new FlashAlgoHeader
+            {
+                version = version,
+                caps = instructions[WORD_CAPS],
+                dispatch = instructions[WORD_DISPATCH],
+                static_base = instructions[WORD_STATIC_BASE],
+                stack = instructions[WORD_STACK],
+                data = instructions[WORD_DATA],
+                data_size = instructions[WORD_DATA_SIZE],
+                ram_size = instructions[WORD_RAM_SIZE],
+            };
+            Debug.Assert(instructions.Count * 4 <= header.ram_size, "Flash algorithm image larger than its RAM");
+            return header;
+        }
+
+        public bool hasCapability(UInt32 cap)
+        {
+            return (this.caps & cap) == cap;
+        }
+
+        // 
+        //         Capability needed by the operation behind a flash_algo entry point key
+        // 
+        public bool supports(string pc_key)
+        {
+            UInt32 op;
+            if (!operations.TryGetValue(pc_key, out op))
+            {
+                return false;
+            }
+            switch (op)
+            {
+                case ALGO_OP_ERASE_CHIP: return this.hasCapability(ALGO_CAP_ERASE_CHIP);
+                case ALGO_OP_ERASE_SECTOR: return this.hasCapability(ALGO_CAP_ERASE_SECTOR);
+                case ALGO_OP_PROGRAM_PAGE: return this.hasCapability(ALGO_CAP_PROGRAM_PAGE);
+                case ALGO_OP_PROGRAM_FILL: return this.hasCapability(ALGO_CAP_PROGRAM_FILL);
+                case ALGO_OP_COMPUTE_CRC: return this.hasCapability(ALGO_CAP_COMPUTE_CRC);
+                default: return true;
+            }
+        }
+    }
+}
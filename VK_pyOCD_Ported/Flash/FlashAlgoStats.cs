@@ -0,0 +1,144 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace openocd.Flash
+{
+    // 
+    //     Performance counters recorded by the flash algorithm
+    // 
+    //     Mirrors struct FlashAlgoStats in Targets/FlashAlgo.h. The block sits at the
+    //     static base of images that report ALGO_CAP_STATS.
+    // 
+    public class FlashAlgoStats
+    {
+        public const UInt32 ALGO_STATS_VERSION = 1;
+
+        // Words before the first operation and words per operation
+        public const int HEADER_WORDS = 2;
+        public const int OP_WORDS = 7;
+        public const int WORD_COUNT = HEADER_WORDS + 4 * OP_WORDS;
+
+        // Host side timings count microseconds instead of core cycles
+        public const UInt32 HOST_CLOCK = 1000000;
+
+        public class OpStats
+        {
+            public UInt32 calls;
+            public UInt32 errors;
+            public UInt32 polls;
+            public UInt32 bytes;
+            public UInt32 cycles_max;
+            public UInt64 cycles;
+
+            public OpStats(List<UInt32> words, int index)
+            {
+                this.calls = words[index + 0];
+                this.errors = words[index + 1];
+                this.polls = words[index + 2];
+                this.bytes = words[index + 3];
+                this.cycles_max = words[index + 4];
+                this.cycles = words[index + 5] | ((UInt64)words[index + 6] << 32);
+            }
+
+            public OpStats()
+            {
+            }
+
+            // 
+            //         Account one call, as StatsEnd does on the target
+            // 
+            public void add(UInt32 bytes, UInt64 cycles, bool failed)
+            {
+                this.calls += 1;
+                this.errors += failed ? 1U : 0U;
+                this.bytes += bytes;
+                this.cycles_max = (UInt32)Math.Min(Math.Max(this.cycles_max, cycles), UInt32.MaxValue);
+                this.cycles += cycles;
+            }
+
+            // 
+            //         Mean time of one call in seconds
+            // 
+            public double getMeanLatency(UInt32 cpu_clock)
+            {
+                return this.calls == 0 ? 0 : (double)this.cycles / cpu_clock / this.calls;
+            }
+
+            public double getMaxLatency(UInt32 cpu_clock)
+            {
+                return (double)this.cycles_max / cpu_clock;
+            }
+
+            // 
+            //         Bytes per second spent inside the algorithm
+            // 
+            public double getThroughput(UInt32 cpu_clock)
+            {
+                return this.cycles == 0 ? 0 : this.bytes / ((double)this.cycles / cpu_clock);
+            }
+
+            public string format(UInt32 cpu_clock)
+            {
+                return String.Format("{0} calls, {1} errors, {2} polls, mean {3:0.000} ms, max {4:0.000} ms, {5:0.00} kB/s",
+                    this.calls, this.errors, this.polls,
+                    this.getMeanLatency(cpu_clock) * 1000, this.getMaxLatency(cpu_clock) * 1000,
+                    this.getThroughput(cpu_clock) / 1024);
+            }
+        }
+
+        public UInt32 version;
+        public OpStats erase_chip;
+        public OpStats erase_sector;
+        public OpStats program_page;
+        public OpStats program_fill;
+
+        // 
+        //         Parse the counters read from the static base
+        // 
+        //         Returns null for a block of an unknown version, so a newer algorithm
+        //         image never aborts the flashing it only reports on.
+        // 
+        public static FlashAlgoStats parse(List<UInt32> words)
+        {
+            if (words.Count < WORD_COUNT || words[0] != ALGO_STATS_VERSION)
+            {
+                Trace.TraceWarning("Unsupported flash algorithm stats version {0}", words.Count > 0 ? words[0] : 0);
+                return null;
+            }
+            return new FlashAlgoStats(words);
+        }
+
+        // 
+        //         Empty counters for timings taken on the host
+        // 
+        public FlashAlgoStats()
+        {
+            this.version = ALGO_STATS_VERSION;
+            this.erase_chip = new OpStats();
+            this.erase_sector = new OpStats();
+            this.program_page = new OpStats();
+            this.program_fill = new OpStats();
+        }
+
+        private FlashAlgoStats(List<UInt32> words)
+        {
+            this.version = words[0];
+            this.erase_chip = new OpStats(words, HEADER_WORDS + 0 * OP_WORDS);
+            this.erase_sector = new OpStats(words, HEADER_WORDS + 1 * OP_WORDS);
+            this.program_page = new OpStats(words, HEADER_WORDS + 2 * OP_WORDS);
+            this.program_fill = new OpStats(words, HEADER_WORDS + 3 * OP_WORDS);
+        }
+
+        public void trace(UInt32 cpu_clock)
+        {
+            Trace.TraceInformation("EraseChip:   {0}", this.erase_chip.format(cpu_clock));
+            Trace.TraceInformation("EraseSector: {0}", this.erase_sector.format(cpu_clock));
+            Trace.TraceInformation("ProgramPage: {0}", this.program_page.format(cpu_clock));
+            Trace.TraceInformation("ProgramFill: {0}", this.program_fill.format(cpu_clock));
+        }
+    }
+}
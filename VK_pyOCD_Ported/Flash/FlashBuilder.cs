@@ -20,11 +20,13 @@ namespace openocd.Flash
         internal double chip_erase_weight;
         internal UInt32 page_erase_count;
         internal double page_erase_weight;
+        internal List<FlashPlanner.SectorPlan> sector_plan;
 
         public const byte FLASH_PAGE_ERASE = 1;
         public const byte FLASH_CHIP_ERASE = 2;
         public const string FLASH_ANALYSIS_CRC32 = "CRC32";
         public const string FLASH_ANALYSIS_PARTIAL_PAGE_READ = "PAGE_READ";
+        public const string FLASH_ANALYSIS_SECTOR_PLAN = "SECTOR_PLAN";
 
         public FlashBuilder(Flash flash, UInt32 base_addr = 0)
         {
@@ -54,28 +56,41 @@ namespace openocd.Flash
         //         program is called.
         //         
         public virtual void addData(UInt32 addr, List<byte> data)
+        {
+            this.addData(addr, new ArraySegment<byte>(data.ToArray()));
+        }
+
+        // 
+        //         Add a slice of an image to be programmed, the data is not copied
+        //         
+        public virtual void addData(UInt32 addr, ArraySegment<byte> data)
         {
             // Sanity check
             if (addr < this.flash_start)
             {
                 throw new Exception(String.Format("Invalid flash address 0x{0:X} is before flash start 0x{1:X}", addr, this.flash_start));
             }
-            // Add operation to list
-            this.flash_operation_list.Add(new FlashBuilderConsts.flash_operation(addr, data));
-            // Keep list sorted
-            this.flash_operation_list = this.flash_operation_list.OrderBy(operation => operation.addr).ToList();
-            // Verify this does not overlap
-            FlashBuilderConsts.flash_operation prev_flash_operation = null;
-            foreach (var operation in this.flash_operation_list)
+            // Add operation to list, keeping it sorted
+            var flash_operation = new FlashBuilderConsts.flash_operation(addr, data);
+            int index = this.flash_operation_list.BinarySearch(flash_operation, FlashBuilderConsts.flash_operation.by_addr);
+            index = index < 0 ? ~index : index;
+            // Verify this does not overlap, only the neighbours can
+            if (index > 0)
             {
-                if (prev_flash_operation != null)
-                {
-                    if (prev_flash_operation.addr + prev_flash_operation.data.Count > operation.addr)
-                    {
-                        throw new ArgumentOutOfRangeException(String.Format("Error adding data - Data at 0x{0:x}..0x{1:x} overlaps with 0x{2:x}..0x{3:x}", prev_flash_operation.addr, prev_flash_operation.addr + prev_flash_operation.data.Count, operation.addr, operation.addr + operation.data.Count));
-                    }
-                }
-                prev_flash_operation = operation;
+                this._check_overlap(this.flash_operation_list[index - 1], flash_operation);
+            }
+            if (index < this.flash_operation_list.Count)
+            {
+                this._check_overlap(flash_operation, this.flash_operation_list[index]);
+            }
+            this.flash_operation_list.Insert(index, flash_operation);
+        }
+
+        private void _check_overlap(FlashBuilderConsts.flash_operation prev_flash_operation, FlashBuilderConsts.flash_operation operation)
+        {
+            if (prev_flash_operation.addr + prev_flash_operation.data.Count > operation.addr)
+            {
+                throw new ArgumentOutOfRangeException(String.Format("Error adding data - Data at 0x{0:x}..0x{1:x} overlaps with 0x{2:x}..0x{3:x}", prev_flash_operation.addr, prev_flash_operation.addr + prev_flash_operation.data.Count, operation.addr, operation.addr + operation.data.Count));
             }
         }
 
@@ -102,14 +117,142 @@ namespace openocd.Flash
                 Trace.TraceWarning("No pages were programmed");
                 return null;
             }
-            // Convert the list of flash operations into flash pages
+            // Data inside the sector geometry of the algorithm is planned per sector,
+            // anything else, like option bytes, goes through the page path
+            FlashDevice device = this.flash.getFlashDevice();
+            FlashPlanner planner = device != null ? new FlashPlanner(device, this.flash.isPartialPageSupported()) : null;
+            List<FlashBuilderConsts.flash_operation> page_operations = new List<FlashBuilderConsts.flash_operation>();
             UInt32 program_byte_count = 0;
-            UInt32 flash_addr = this.flash_operation_list[0].addr;
+            UInt32 planned_byte_count = 0;
+            foreach (FlashBuilderConsts.flash_operation flash_op in this.flash_operation_list)
+            {
+                program_byte_count += (UInt32)flash_op.data.Count;
+                if (planner != null && planner.addData(flash_op.addr, flash_op.data))
+                {
+                    planned_byte_count += (UInt32)flash_op.data.Count;
+                }
+                else
+                {
+                    page_operations.Add(flash_op);
+                }
+            }
+            // Progress is shared between both paths by their amount of data
+            Action<double> sector_progress_cb = progress_cb;
+            Action<double> page_progress_cb = progress_cb;
+            if (planned_byte_count > 0 && page_operations.Count > 0)
+            {
+                double share = (double)planned_byte_count / program_byte_count;
+                Action<double> total_progress_cb = progress_cb;
+                sector_progress_cb = progress => total_progress_cb(progress * share);
+                page_progress_cb = progress => total_progress_cb(share + progress * (1 - share));
+            }
+            this.flash.init();
+            byte? flash_operation = null;
+            if (planned_byte_count > 0)
+            {
+                flash_operation = this._program_sectors(planner, chip_erase, smart_flash, fast_verify, sector_progress_cb);
+                // Any chip erase has been done, the page path must not erase the planned data
+                chip_erase = false;
+            }
+            if (page_operations.Count > 0)
+            {
+                flash_operation = this._program_pages(page_operations, chip_erase, smart_flash, fast_verify, page_progress_cb);
+            }
+            // Collect the timings of this batch and use them for the next one,
+            // algorithms without counters are timed on the host
+            FlashAlgoStats algo_stats = this.flash.readStats();
+            if (algo_stats != null)
+            {
+                algo_stats.trace(this.flash.getCpuClock());
+                this.perf.algo_stats = algo_stats;
+            }
+            this.flash.calibrate(algo_stats);
+            this.flash.target.resetStopOnReset();
+            DateTime program_finish = DateTime.Now;
+            this.perf.program_time = program_finish - program_start;
+            this.perf.program_type = flash_operation.ToString();
+            int page_count = this.page_list.Count + (this.sector_plan != null ? this.sector_plan.Sum(sector_plan => sector_plan.pages.Count) : 0);
+            Trace.TraceInformation("Programmed {0} bytes ({1} pages) at {2:0.00} kB/s", program_byte_count, page_count, program_byte_count / 1024 / ((TimeSpan)this.perf.program_time).TotalSeconds);
+            return this.perf;
+        }
+
+        // 
+        //         Program the data added to planner with erases planned per sector
+        // 
+        //         The chip erase estimate comes from the image alone, so flash is only
+        //         read when a sector erase is considered.
+        //         
+        public virtual byte _program_sectors(FlashPlanner planner, bool? chip_erase, bool smart_flash, bool fast_verify, Action<double> progress_cb)
+        {
+            List<FlashDevice.Sector> sectors = planner.getSectors();
+            // If the first sector being programmed is not the first sector
+            // in ROM then don't use a chip erase
+            if (sectors[0].addr > this.flash_start)
+            {
+                if (chip_erase == null)
+                {
+                    chip_erase = false;
+                }
+                else if (chip_erase == true)
+                {
+                    Trace.TraceWarning("Chip erase used when flash address 0x{0:X} is not the same as flash start 0x{1:X}", sectors[0].addr, this.flash_start);
+                }
+            }
+            List<FlashPlanner.SectorPlan> erased_plan = planner.planErased();
+            FlashConsts.PageInfo info = this.flash.getPageInfo(sectors[0].addr);
+            this.chip_erase_count = (UInt32)erased_plan.Sum(sector_plan => sector_plan.pages.Count);
+            this.chip_erase_weight = (double)this.flash.getFlashInfo().erase_weight + FlashPlanner.getWeight(erased_plan, size => 0, (double)info.program_weight);
+            TimeSpan chip_erase_program_time = TimeSpan.FromSeconds(this.chip_erase_weight);
+            // Any sector plan at least reads back the sectors or their CRC
+            TimeSpan sector_erase_min_program_time = TimeSpan.FromSeconds((float)sectors.Sum(sector => (double)sector.size) / (float)FlashBuilderConsts.DATA_TRANSFER_B_PER_S);
+            // If chip_erase hasn't been specified determine if chip erase is faster
+            // than sector erase regardless of contents
+            if (chip_erase == null && chip_erase_program_time < sector_erase_min_program_time)
+            {
+                chip_erase = true;
+            }
+
+            TimeSpan sector_program_time = TimeSpan.Zero;
+            UInt32 sector_erase_count = 0;
+            if (chip_erase != true)
+            {
+                DateTime analyze_start = DateTime.Now;
+                var _tup_1 = this._compute_sector_plan(planner, smart_flash, fast_verify);
+                sector_erase_count = _tup_1.Item1;
+                sector_program_time = TimeSpan.FromSeconds(_tup_1.Item2);
+                this.perf.analyze_type = FlashBuilder.FLASH_ANALYSIS_SECTOR_PLAN;
+                DateTime analyze_finish = DateTime.Now;
+                this.perf.analyze_time = analyze_finish - analyze_start;
+                Trace.TraceInformation(String.Format("Analyze time: {0}", analyze_finish - analyze_start));
+            }
+            if (chip_erase == null)
+            {
+                Trace.TraceInformation(String.Format("Chip erase count {0}, Sector erase est count {1}", this.chip_erase_count, sector_erase_count));
+                chip_erase = chip_erase_program_time < sector_program_time;
+            }
+            if ((bool)chip_erase)
+            {
+                this.sector_plan = erased_plan;
+                return this._chip_erase_sector_program(erased_plan, progress_cb);
+            }
+            return this._sector_erase_program(this.sector_plan, progress_cb);
+        }
+
+        // 
+        //         Program data outside of the sector geometry a page at a time
+        // 
+        //         Gaps within a page are read back, and erased pages or pages that
+        //         are already the same are found by CRC or by reading them.
+        //         
+        public virtual byte _program_pages(List<FlashBuilderConsts.flash_operation> flash_operations, bool? chip_erase, bool smart_flash, bool fast_verify, Action<double> progress_cb)
+        {
+            // Convert the list of flash operations into flash pages
+            UInt32 flash_addr = flash_operations[0].addr;
             FlashConsts.PageInfo info = this.flash.getPageInfo(flash_addr);
             UInt32 page_addr = flash_addr - flash_addr % (UInt32)info.size;
             var current_page = new FlashBuilderConsts.flash_page(page_addr, (UInt32)info.size, new List<byte>(), (double)info.erase_weight, (double)info.program_weight);
             this.page_list.Add(current_page);
-            foreach (FlashBuilderConsts.flash_operation flash_op in this.flash_operation_list)
+            foreach (FlashBuilderConsts.flash_operation flash_op in flash_operations)
             {
                 UInt32 pos = 0;
                 while (pos < flash_op.data.Count)
@@ -134,8 +277,7 @@ namespace openocd.Flash
                     UInt32 space_left_in_page = (UInt32)(info.size - current_page.data.Count);
                     UInt32 space_left_in_data = (UInt32)flash_op.data.Count - pos;
                     UInt32 amount = Math.Min(space_left_in_page, space_left_in_data);
-                    current_page.data.AddRange(flash_op.data.GetRange((int)pos, (int)amount));
-                    program_byte_count += amount;
+                    current_page.data.AddRange(new ArraySegment<byte>(flash_op.data.Array, flash_op.data.Offset + (int)pos, (int)amount));
                     //increment position
                     pos += amount;
                 }
@@ -159,7 +301,6 @@ namespace openocd.Flash
                     Trace.TraceWarning("Chip erase used when flash address 0x{0:X} is not the same as flash start 0x{1:X}", this.page_list[0].addr, this.flash_start);
                 }
             }
-            this.flash.init();
             var _tup_1 = this._compute_chip_erase_pages_and_weight();
             var chip_erase_count = _tup_1.Item1;
             TimeSpan chip_erase_program_time = TimeSpan.FromSeconds(_tup_1.Item2);
@@ -174,7 +315,7 @@ namespace openocd.Flash
             TimeSpan page_program_time = TimeSpan.Zero;
             UInt32 sector_erase_count = 0;
             // If chip erase isn't True then analyze the flash
-            if (!(bool)chip_erase)
+            if (chip_erase != true)
             {
                 DateTime analyze_start = DateTime.Now;
                 if ((bool)this.flash.getFlashInfo().crc_supported)
@@ -225,12 +366,7 @@ namespace openocd.Flash
             {
                 flash_operation = this._page_erase_program(progress_cb);
             }
-            this.flash.target.resetStopOnReset();
-            DateTime program_finish = DateTime.Now;
-            this.perf.program_time = program_finish - program_start;
-            this.perf.program_type = flash_operation.ToString();
-            Trace.TraceInformation("Programmed {0} bytes ({1} pages) at {2:0.00} kB/s", program_byte_count, this.page_list.Count, program_byte_count / 1024 / ((TimeSpan)this.perf.program_time).TotalSeconds);
-            return this.perf;
+            return (byte)flash_operation;
         }
 
         public virtual FlashBuilderConsts.ProgrammingInfo getPerformance()
@@ -334,7 +470,45 @@ namespace openocd.Flash
         }
 
 
-        private UInt32 crc32(IEnumerable<byte> data) => throw new NotImplementedException();
+        private UInt32 crc32(List<byte> data) => FlashBuilderConsts.crc32(data.ToArray(), 0, data.Count);
+
+        // 
+        //         Plan sector erases and page programs from the device geometry.
+        // 
+        //         Sectors fully covered by new data are compared by CRC when the
+        //         analyzer is available, all others are read back and compared.
+        //         Without smart_flash every sector the data touches is erased and
+        //         programmed. The plan is kept in sector_plan.
+        //         
+        public virtual Tuple<UInt32, double> _compute_sector_plan(FlashPlanner planner, bool smart_flash = true, bool assume_estimate_correct = false)
+        {
+            Dictionary<UInt32, UInt32> device_crcs = null;
+            if (smart_flash && (bool)this.flash.getFlashInfo().crc_supported)
+            {
+                // The analyzer handles power of 2 sizes on their own alignment only
+                List<FlashDevice.Sector> sectors = planner.getCoveredSectors()
+                    .Where(sector => (sector.size & (sector.size - 1)) == 0 && sector.addr % sector.size == 0)
+                    .ToList();
+                if (sectors.Count > 0)
+                {
+                    List<UInt32> crcs = this.flash.computeCrcs(sectors.Select(sector => Tuple.Create(sector.addr, sector.size)));
+                    device_crcs = sectors.Zip(crcs, (sector, crc) => Tuple.Create(sector.addr, crc)).ToDictionary(t => t.Item1, t => t.Item2);
+                }
+            }
+            List<FlashPlanner.SectorPlan> plan = planner.plan(
+                (addr, size) => this.flash.target.readBlockMemoryUnaligned8(addr, size).ToArray(),
+                device_crcs,
+                FlashBuilderConsts.crc32,
+                assume_estimate_correct,
+                smart_flash);
+            UInt32 page_erase_count = (UInt32)plan.Count(sector_plan => sector_plan.action == FlashPlanner.SectorAction.ERASE_PROGRAM);
+            FlashConsts.PageInfo info = this.flash.getPageInfo(plan.Count > 0 ? plan[0].sector.addr : this.flash_start);
+            double page_erase_weight = FlashPlanner.getWeight(plan, this.flash.getSectorEraseWeight, (double)info.program_weight);
+            this.sector_plan = plan;
+            this.page_erase_count = page_erase_count;
+            this.page_erase_weight = page_erase_weight;
+            return Tuple.Create(page_erase_count, page_erase_weight);
+        }
 
         // 
         //         Estimate how many pages are the same.
@@ -429,7 +603,7 @@ namespace openocd.Flash
             {
                 if (!(bool)page.erased)
                 {
-                    this.flash.programPage(page.addr, page.data);
+                    this._program_page(page);
                     progress += page.getProgramWeight();
                     progress_cb((float)(progress) / (float)(this.chip_erase_weight));
                 }
@@ -438,6 +612,43 @@ namespace openocd.Flash
             return FlashBuilder.FLASH_CHIP_ERASE;
         }
 
+        // 
+        //         Program one erased page.
+        // 
+        //         A page holding a single repeated word is filled on the target
+        //         so its data does not have to be transferred.
+        //         
+        public virtual void _program_page(FlashBuilderConsts.flash_page page)
+        {
+            this._program_data(page.addr, page.data);
+        }
+
+        public virtual void _program_data(UInt32 addr, ArraySegment<byte> data)
+        {
+            UInt32? pattern = FlashBuilderConsts._fill_pattern(data);
+            if (pattern != null && this.flash.isProgramFillSupported())
+            {
+                this.flash.programFill(addr, (UInt32)data.Count, (UInt32)pattern);
+            }
+            else
+            {
+                this.flash.programPage(addr, data);
+            }
+        }
+
+        public virtual void _program_data(UInt32 addr, List<byte> data)
+        {
+            UInt32? pattern = FlashBuilderConsts._fill_pattern(data);
+            if (pattern != null && this.flash.isProgramFillSupported())
+            {
+                this.flash.programFill(addr, (UInt32)data.Count, (UInt32)pattern);
+            }
+            else
+            {
+                this.flash.programPage(addr, data);
+            }
+        }
+
         public virtual Tuple<FlashBuilderConsts.flash_page, UInt32> _next_unerased_page(UInt32 i)
         {
             if (i >= this.page_list.Count)
@@ -546,7 +757,7 @@ namespace openocd.Flash
                 if (page.same == false)
                 {
                     this.flash.erasePage(page.addr);
-                    this.flash.programPage(page.addr, page.data);
+                    this._program_page(page);
                     actual_page_erase_count += 1;
                     actual_page_erase_weight += page.getEraseProgramWeight();
                 }
@@ -562,6 +773,65 @@ namespace openocd.Flash
             return FlashBuilder.FLASH_PAGE_ERASE;
         }
 
+        // 
+        //         Program a plan made for an erased device after a chip erase.
+        //         
+        public virtual byte _chip_erase_sector_program(List<FlashPlanner.SectorPlan> plan, Action<double> progress_cb = null)
+        {
+            progress_cb = progress_cb ?? FlashBuilderConsts._stub_progress;
+            FlashConsts.PageInfo info = this.flash.getPageInfo(plan[0].sector.addr);
+            Trace.TraceInformation("Smart chip erase");
+            progress_cb(0.0);
+            double progress = 0;
+            this.flash.eraseAll();
+            progress += (double)(this.flash.getFlashInfo().erase_weight);
+            foreach (var sector_plan in plan)
+            {
+                foreach (var page in sector_plan.pages)
+                {
+                    this._program_data(page.addr, page.data);
+                    progress += (double)info.program_weight + (float)(page.data.Count) / (float)(FlashBuilderConsts.DATA_TRANSFER_B_PER_S);
+                    progress_cb((float)(progress) / (float)(this.chip_erase_weight));
+                }
+            }
+            progress_cb(1.0);
+            Trace.TraceInformation("Pages programmed: {0}", this.chip_erase_count);
+            return FlashBuilder.FLASH_CHIP_ERASE;
+        }
+
+        // 
+        //         Program by executing a sector plan.
+        //         
+        public virtual byte _sector_erase_program(List<FlashPlanner.SectorPlan> plan, Action<double> progress_cb = null)
+        {
+            progress_cb = progress_cb ?? FlashBuilderConsts._stub_progress;
+            FlashConsts.PageInfo info = this.flash.getPageInfo(plan.Count > 0 ? plan[0].sector.addr : this.flash_start);
+            UInt32 program_count = 0;
+            double progress = 0;
+            progress_cb(0.0);
+            foreach (var sector_plan in plan)
+            {
+                if (sector_plan.action == FlashPlanner.SectorAction.ERASE_PROGRAM)
+                {
+                    this.flash.erasePage(sector_plan.sector.addr);
+                    progress += this.flash.getSectorEraseWeight(sector_plan.sector.size);
+                }
+                foreach (var page in sector_plan.pages)
+                {
+                    this._program_data(page.addr, page.data);
+                    program_count += 1;
+                    progress += (double)info.program_weight + (float)(page.data.Count) / (float)(FlashBuilderConsts.DATA_TRANSFER_B_PER_S);
+                }
+                if (this.page_erase_weight > 0)
+                {
+                    progress_cb((float)(progress) / (float)(this.page_erase_weight));
+                }
+            }
+            progress_cb(1.0);
+            Trace.TraceInformation("Sectors erased: {0} of {1}, pages programmed: {2}", this.page_erase_count, plan.Count, program_count);
+            return FlashBuilder.FLASH_PAGE_ERASE;
+        }
+
         // 
         //         Program by performing sector erases.
         //         
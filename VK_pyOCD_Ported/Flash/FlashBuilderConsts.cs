@@ -21,6 +21,7 @@ namespace openocd.Flash
             internal TimeSpan? program_time;
             internal string analyze_type;
             internal TimeSpan? analyze_time;
+            internal FlashAlgoStats algo_stats;
 
             public ProgrammingInfo()
             {
@@ -28,6 +29,7 @@ namespace openocd.Flash
                 this.program_time = null;
                 this.analyze_type = null;
                 this.analyze_time = null;
+                this.algo_stats = null;
             }
         }
 
@@ -49,6 +51,75 @@ namespace openocd.Flash
             return d.All(b => b == 0xFF);
         }
 
+        // 
+        //         Return the 32-bit pattern if data is one word repeated, otherwise null
+        //         
+        public static UInt32? _fill_pattern(IList<byte> d)
+        {
+            if (d.Count == 0 || d.Count % 4 != 0)
+            {
+                return null;
+            }
+            for (int i = 4; i < d.Count; i++)
+            {
+                if (d[i] != d[i % 4])
+                {
+                    return null;
+                }
+            }
+            return (UInt32)(d[0] | (d[1] << 8) | (d[2] << 16) | (d[3] << 24));
+        }
+
+        // 
+        //         Drop trailing erased (0xFF) bytes, they are a no-op after an erase
+        // 
+        //         The length is rounded up to a multiple of unit, the program unit of
+        //         the flash, so the algorithm sees the same alignment.
+        //         
+        public static List<byte> _strip_erased_tail(List<byte> d, int unit)
+        {
+            int count = _erased_tail_start(d, unit);
+            return count == d.Count ? d : d.GetRange(0, count);
+        }
+
+        public static ArraySegment<byte> _strip_erased_tail(ArraySegment<byte> d, int unit)
+        {
+            return new ArraySegment<byte>(d.Array, d.Offset, _erased_tail_start(d, unit));
+        }
+
+        private static int _erased_tail_start(IList<byte> d, int unit)
+        {
+            int count = d.Count;
+            while (count > 0 && d[count - 1] == 0xFF)
+            {
+                count -= 1;
+            }
+            return Math.Min((count + unit - 1) / unit * unit, d.Count);
+        }
+
+        private static readonly UInt32[] crc32_table = Enumerable.Range(0, 256).Select(n =>
+        {
+            UInt32 crc = (UInt32)n;
+            for (int i = 0; i < 8; i++)
+            {
+                crc = (crc & 1) != 0 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+            }
+            return crc;
+        }).ToArray();
+
+        // 
+        //         CRC-32 as computed by the analyzer on the target
+        //         
+        public static UInt32 crc32(byte[] data, int offset, int count)
+        {
+            UInt32 crc = 0xFFFFFFFF;
+            for (int i = offset; i < offset + count; i++)
+            {
+                crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return crc ^ 0xFFFFFFFF;
+        }
+
         public static Action<double> _stub_progress = new Action<double>((double percent) => { });
 
         public class flash_page
@@ -106,9 +177,11 @@ namespace openocd.Flash
         public class flash_operation
         {
             internal UInt32 addr;
-            internal List<byte> data;
+            internal ArraySegment<byte> data;
+
+            internal static readonly IComparer<flash_operation> by_addr = Comparer<flash_operation>.Create((a, b) => a.addr.CompareTo(b.addr));
 
-            public flash_operation(UInt32 addr, List<byte> data)
+            public flash_operation(UInt32 addr, ArraySegment<byte> data)
             {
                 this.addr = addr;
                 this.data = data;
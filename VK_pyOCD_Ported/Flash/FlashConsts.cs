@@ -11,6 +11,8 @@ namespace openocd.Flash
         public const double DEFAULT_PAGE_PROGRAM_WEIGHT = 0.13;
         public const double DEFAULT_PAGE_ERASE_WEIGHT = 0.048;
         public const double DEFAULT_CHIP_ERASE_WEIGHT = 0.174;
+        // Core clock the flash algorithm runs at, used to convert its cycle counts
+        public const UInt32 DEFAULT_CPU_CLOCK = 16000000;
 
         // Program to compute the CRC of sectors.  This works on cortex-m processors.
         // Code is relocatable and only needs to be on a 4 byte boundary.
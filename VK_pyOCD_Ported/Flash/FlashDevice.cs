@@ -0,0 +1,167 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace openocd.Flash
+{
+    // 
+    //     Device description of a flash algorithm
+    // 
+    //     Mirrors struct FlashDevice from FlashOS.H, as compiled from Targets/FlashDev.c
+    //     into the DevDscr region at the end of the algorithm image.
+    // 
+    public class FlashDevice
+    {
+        public const UInt16 FLASH_DRV_VERS_MAJOR = 0x0100;
+        public const UInt32 SECTOR_END = 0xFFFFFFFF;
+
+        // Byte offsets inside struct FlashDevice
+        private const int OFFSET_NAME = 2;
+        private const int NAME_LENGTH = 128;
+        private const int OFFSET_DEV_TYPE = 130;
+        private const int OFFSET_DEV_ADR = 132;
+        private const int OFFSET_SZ_DEV = 136;
+        private const int OFFSET_SZ_PAGE = 140;
+        private const int OFFSET_VAL_EMPTY = 148;
+        private const int OFFSET_TO_PROG = 152;
+        private const int OFFSET_TO_ERASE = 156;
+        private const int OFFSET_SECTORS = 160;
+
+        public class Sector
+        {
+            public readonly UInt32 addr;
+            public readonly UInt32 size;
+
+            public Sector(UInt32 addr, UInt32 size)
+            {
+                this.addr = addr;
+                this.size = size;
+            }
+        }
+
+        public string name;
+        public UInt16 dev_type;
+        public UInt32 dev_adr;
+        public UInt32 sz_dev;
+        public UInt32 sz_page;
+        public byte val_empty;
+        public UInt32 to_prog;
+        public UInt32 to_erase;
+        // Sector sizes start at these device offsets and repeat up to the next entry
+        public List<Sector> sector_groups;
+        // Start offsets of sector_groups, for the binary search
+        private UInt32[] group_starts;
+
+        public FlashDevice(string name, UInt32 dev_adr, UInt32 sz_dev, UInt32 sz_page, byte val_empty, List<Sector> sector_groups)
+        {
+            this.name = name;
+            this.dev_adr = dev_adr;
+            this.sz_dev = sz_dev;
+            this.sz_page = sz_page;
+            this.val_empty = val_empty;
+            this.sector_groups = sector_groups;
+            this.group_starts = sector_groups.Select(group => group.addr).ToArray();
+            Debug.Assert(this.group_starts.Length > 0 && this.group_starts[0] == 0);
+        }
+
+        // 
+        //         Locate and parse the device description in an algorithm image
+        // 
+        //         Returns null if the image does not contain one.
+        // 
+        public static FlashDevice find(List<UInt32> instructions)
+        {
+            byte[] image = new byte[instructions.Count * 4];
+            Buffer.BlockCopy(instructions.ToArray(), 0, image, 0, image.Length);
+            for (int offset = 0; offset + OFFSET_SECTORS + 8 <= image.Length; offset += 4)
+            {
+                FlashDevice device = parse(image, offset);
+                if (device != null)
+                {
+                    return device;
+                }
+            }
+            return null;
+        }
+
+        // 
+        //         Parse struct FlashDevice at offset, null if it does not look like one
+        // 
+        public static FlashDevice parse(byte[] image, int offset)
+        {
+            UInt16 vers = BitConverter.ToUInt16(image, offset);
+            if ((vers & 0xFF00) != FLASH_DRV_VERS_MAJOR || image[offset + OFFSET_NAME] == 0)
+            {
+                return null;
+            }
+            UInt32 sz_dev = BitConverter.ToUInt32(image, offset + OFFSET_SZ_DEV);
+            UInt32 sz_page = BitConverter.ToUInt32(image, offset + OFFSET_SZ_PAGE);
+            if (sz_dev == 0 || sz_page == 0 || (sz_page & (sz_page - 1)) != 0)
+            {
+                return null;
+            }
+            List<Sector> groups = new List<Sector>();
+            for (int pos = offset + OFFSET_SECTORS; pos + 8 <= image.Length; pos += 8)
+            {
+                UInt32 size = BitConverter.ToUInt32(image, pos);
+                UInt32 addr = BitConverter.ToUInt32(image, pos + 4);
+                if (size == SECTOR_END && addr == SECTOR_END)
+                {
+                    break;
+                }
+                // Sector groups start at 0 and ascend
+                bool ascending = groups.Count == 0 ? addr == 0 : addr > groups.Last().addr;
+                if (size == 0 || !ascending || addr >= sz_dev)
+                {
+                    return null;
+                }
+                groups.Add(new Sector(addr, size));
+            }
+            if (groups.Count == 0)
+            {
+                return null;
+            }
+            string name = Encoding.ASCII.GetString(image, offset + OFFSET_NAME, NAME_LENGTH).Split('\0')[0];
+            FlashDevice device = new FlashDevice(
+                name,
+                BitConverter.ToUInt32(image, offset + OFFSET_DEV_ADR),
+                sz_dev,
+                sz_page,
+                image[offset + OFFSET_VAL_EMPTY],
+                groups);
+            device.dev_type = BitConverter.ToUInt16(image, offset + OFFSET_DEV_TYPE);
+            device.to_prog = BitConverter.ToUInt32(image, offset + OFFSET_TO_PROG);
+            device.to_erase = BitConverter.ToUInt32(image, offset + OFFSET_TO_ERASE);
+            return device;
+        }
+
+        public bool contains(UInt32 addr)
+        {
+            return addr >= this.dev_adr && addr - this.dev_adr < this.sz_dev;
+        }
+
+        // 
+        //         Get the erase sector that contains this address
+        // 
+        public Sector getSector(UInt32 addr)
+        {
+            if (!this.contains(addr))
+            {
+                return null;
+            }
+            UInt32 offset = addr - this.dev_adr;
+            int index = Array.BinarySearch(this.group_starts, offset);
+            if (index < 0)
+            {
+                // Index of the group starting below offset
+                index = ~index - 1;
+            }
+            Sector group = this.sector_groups[index];
+            UInt32 sector_offset = offset - (offset - group.addr) % group.size;
+            return new Sector(this.dev_adr + sector_offset, group.size);
+        }
+    }
+}
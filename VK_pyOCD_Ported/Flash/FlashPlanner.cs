@@ -0,0 +1,481 @@
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.Linq;
+using System.Numerics;
+using System.Text;
+using System.Threading.Tasks;
+
+namespace openocd.Flash
+{
+    // 
+    //     Plans erase and program operations from the sector geometry of a FlashDevice
+    // 
+    //     Image data is kept as slices of the caller's arrays. Pages are only copied
+    //     when they have to be merged with the current flash contents.
+    // 
+    public class FlashPlanner
+    {
+        public enum SectorAction
+        {
+            // Contents already match
+            SKIP,
+            // Only erased words change, program without erase
+            PROGRAM,
+            // Erase the sector, then program all non-empty pages
+            ERASE_PROGRAM,
+        }
+
+        public class PagePlan
+        {
+            public readonly UInt32 addr;
+            public readonly ArraySegment<byte> data;
+
+            public PagePlan(UInt32 addr, ArraySegment<byte> data)
+            {
+                this.addr = addr;
+                this.data = data;
+            }
+        }
+
+        public class SectorPlan
+        {
+            public readonly FlashDevice.Sector sector;
+            public SectorAction action;
+            // Decision is based on a hash match only, contents were not read
+            public bool hash_only;
+            public List<PagePlan> pages;
+
+            public SectorPlan(FlashDevice.Sector sector)
+            {
+                this.sector = sector;
+                this.action = SectorAction.SKIP;
+                this.hash_only = false;
+                this.pages = new List<PagePlan>();
+            }
+        }
+
+        private class Segment
+        {
+            internal UInt32 addr;
+            internal ArraySegment<byte> data;
+
+            internal UInt32 end
+            {
+                get { return this.addr + (UInt32)this.data.Count; }
+            }
+        }
+
+        private readonly FlashDevice device;
+        // The algorithm skips erased words, so changes into erased words need no erase
+        private readonly bool partial_page;
+        private readonly List<Segment> segments;
+        private static readonly IComparer<Segment> by_addr = Comparer<Segment>.Create((a, b) => a.addr.CompareTo(b.addr));
+
+        public FlashPlanner(FlashDevice device, bool partial_page = true)
+        {
+            this.device = device;
+            this.partial_page = partial_page;
+            this.segments = new List<Segment>();
+        }
+
+        public bool addData(UInt32 addr, byte[] data)
+        {
+            return this.addData(addr, new ArraySegment<byte>(data));
+        }
+
+        // 
+        //         Add a slice of the image, the data is not copied
+        // 
+        //         Returns false without adding it when the data is not entirely inside
+        //         the device, e.g. option bytes, so the caller can program it otherwise.
+        // 
+        public bool addData(UInt32 addr, ArraySegment<byte> data)
+        {
+            if (data.Count == 0 || !this.device.contains(addr) || !this.device.contains(addr + (UInt32)data.Count - 1))
+            {
+                return false;
+            }
+            Segment segment = new Segment { addr = addr, data = data };
+            int index = this.segments.BinarySearch(segment, by_addr);
+            index = index < 0 ? ~index : index;
+            // Only the neighbours can overlap
+            if ((index > 0 && this.segments[index - 1].end > addr) ||
+                (index < this.segments.Count && segment.end > this.segments[index].addr))
+            {
+                throw new ArgumentOutOfRangeException(String.Format("Error adding data - Data at 0x{0:x}..0x{1:x} overlaps", addr, segment.end));
+            }
+            this.segments.Insert(index, segment);
+            return true;
+        }
+
+        // 
+        //         Sectors the image writes to
+        // 
+        public List<FlashDevice.Sector> getSectors()
+        {
+            List<FlashDevice.Sector> sectors = new List<FlashDevice.Sector>();
+            foreach (Segment segment in this.segments)
+            {
+                UInt32 addr = segment.addr;
+                while (addr < segment.end)
+                {
+                    FlashDevice.Sector sector = this.device.getSector(addr);
+                    if (sectors.Count == 0 || sectors.Last().addr != sector.addr)
+                    {
+                        sectors.Add(sector);
+                    }
+                    addr = sector.addr + sector.size;
+                }
+            }
+            return sectors;
+        }
+
+        // 
+        //         Sectors the image fully covers, their contents can be checked with a hash alone
+        // 
+        public List<FlashDevice.Sector> getCoveredSectors()
+        {
+            List<FlashDevice.Sector> covered = new List<FlashDevice.Sector>();
+            int first = 0;
+            foreach (FlashDevice.Sector sector in this.getSectors())
+            {
+                first = this._first_segment(sector, first);
+                if (this._covered(sector, first) == sector.size)
+                {
+                    covered.Add(sector);
+                }
+            }
+            return covered;
+        }
+
+        // 
+        //         Compute the minimal plan
+        // 
+        //         read_memory(addr, size) returns the current flash contents.
+        //         device_hashes maps sector addresses to a hash of their current contents,
+        //         computed on the target with the same function as hash. A sector whose hash
+        //         matches is skipped without reading it when assume_hash_correct is set.
+        //         Without smart every sector is erased and programmed, partly covered ones
+        //         are still read to keep the bytes outside the image.
+        // 
+        public List<SectorPlan> plan(
+            Func<UInt32, UInt32, byte[]> read_memory,
+            IDictionary<UInt32, UInt32> device_hashes = null,
+            Func<byte[], int, int, UInt32> hash = null,
+            bool assume_hash_correct = false,
+            bool smart = true)
+        {
+            List<SectorPlan> plans = new List<SectorPlan>();
+            int first = 0;
+            foreach (FlashDevice.Sector sector in this.getSectors())
+            {
+                first = this._first_segment(sector, first);
+                SectorPlan sector_plan = new SectorPlan(sector);
+                if (!smart)
+                {
+                    byte[] old = this._covered(sector, first) == sector.size ? null : read_memory(sector.addr, sector.size);
+                    sector_plan.action = SectorAction.ERASE_PROGRAM;
+                    this._add_pages(sector_plan, first, null, () => this._merge(sector, old, first));
+                    plans.Add(sector_plan);
+                    continue;
+                }
+                UInt32 device_hash;
+                if (hash != null && device_hashes != null && device_hashes.TryGetValue(sector.addr, out device_hash) &&
+                    this._covered(sector, first) == sector.size)
+                {
+                    ArraySegment<byte> image = this._slice(sector.addr, sector.size, first) ?? new ArraySegment<byte>(this._merge(sector, null, first));
+                    if (hash(image.Array, image.Offset, image.Count) == device_hash)
+                    {
+                        if (assume_hash_correct)
+                        {
+                            sector_plan.hash_only = true;
+                            plans.Add(sector_plan);
+                            continue;
+                        }
+                    }
+                    else
+                    {
+                        // Sector differs and the image replaces all of it
+                        sector_plan.hash_only = true;
+                        sector_plan.action = SectorAction.ERASE_PROGRAM;
+                        this._add_pages(sector_plan, first, null, () => this._merge(sector, null, first));
+                        plans.Add(sector_plan);
+                        continue;
+                    }
+                }
+                byte[] current = read_memory(sector.addr, sector.size);
+                Debug.Assert(current.Length == sector.size);
+                sector_plan.action = this._compare(sector, current, first);
+                if (sector_plan.action == SectorAction.ERASE_PROGRAM)
+                {
+                    this._add_pages(sector_plan, first, null, () => this._merge(sector, current, first));
+                }
+                else if (sector_plan.action == SectorAction.PROGRAM)
+                {
+                    this._add_pages(sector_plan, first, current, () => this._merge(sector, current, first));
+                }
+                plans.Add(sector_plan);
+            }
+            return plans;
+        }
+
+        // 
+        //         Plan the programs after a chip erase, nothing is read
+        // 
+        //         Bytes outside the image are lost, like any chip erase loses them.
+        // 
+        public List<SectorPlan> planErased()
+        {
+            List<SectorPlan> plans = new List<SectorPlan>();
+            int first = 0;
+            foreach (FlashDevice.Sector sector in this.getSectors())
+            {
+                first = this._first_segment(sector, first);
+                SectorPlan sector_plan = new SectorPlan(sector);
+                sector_plan.action = SectorAction.PROGRAM;
+                this._add_pages(sector_plan, first, null, () => this._merge(sector, null, first));
+                plans.Add(sector_plan);
+            }
+            return plans;
+        }
+
+        // Index of the first segment reaching into the sector, searching on from the previous sector's
+        private int _first_segment(FlashDevice.Sector sector, int first)
+        {
+            while (this.segments[first].end <= sector.addr)
+            {
+                first += 1;
+            }
+            return first;
+        }
+
+        // Bytes of the sector covered by image data
+        private UInt32 _covered(FlashDevice.Sector sector, int first)
+        {
+            UInt32 covered = 0;
+            foreach (Segment segment in this._segments_in(sector, first))
+            {
+                covered += Math.Min(segment.end, sector.addr + sector.size) - Math.Max(segment.addr, sector.addr);
+            }
+            return covered;
+        }
+
+        private IEnumerable<Segment> _segments_in(FlashDevice.Sector sector, int first)
+        {
+            UInt32 sector_end = sector.addr + sector.size;
+            for (int i = first; i < this.segments.Count && this.segments[i].addr < sector_end; i++)
+            {
+                if (this.segments[i].end > sector.addr)
+                {
+                    yield return this.segments[i];
+                }
+            }
+        }
+
+        // 
+        //         Decide what the sector needs by comparing image data with its current contents
+        // 
+        private SectorAction _compare(FlashDevice.Sector sector, byte[] current, int first)
+        {
+            SectorAction action = SectorAction.SKIP;
+            foreach (Segment segment in this._segments_in(sector, first))
+            {
+                UInt32 start = Math.Max(segment.addr, sector.addr);
+                UInt32 end = Math.Min(segment.end, sector.addr + sector.size);
+                int image_offset = segment.data.Offset + (int)(start - segment.addr);
+                int current_offset = (int)(start - sector.addr);
+                int count = (int)(end - start);
+                if (_same(segment.data.Array, image_offset, current, current_offset, count))
+                {
+                    continue;
+                }
+                if (!this.partial_page)
+                {
+                    return SectorAction.ERASE_PROGRAM;
+                }
+                // Differences can be programmed without erase only into words that are still empty
+                for (int i = 0; i < count; i++)
+                {
+                    if (segment.data.Array[image_offset + i] != current[current_offset + i] &&
+                        !_erased(current, (current_offset + i) & ~3, 4, this.device.val_empty))
+                    {
+                        return SectorAction.ERASE_PROGRAM;
+                    }
+                }
+                action = SectorAction.PROGRAM;
+            }
+            return action;
+        }
+
+        // 
+        //         Build the sector as it should be after programming
+        // 
+        //         Bytes not covered by the image keep their current value, or are empty
+        //         when current is null.
+        // 
+        private byte[] _merge(FlashDevice.Sector sector, byte[] current, int first)
+        {
+            byte[] merged = new byte[sector.size];
+            if (current != null)
+            {
+                Buffer.BlockCopy(current, 0, merged, 0, merged.Length);
+            }
+            else
+            {
+                _fill(merged, 0, merged.Length, this.device.val_empty);
+            }
+            foreach (Segment segment in this._segments_in(sector, first))
+            {
+                UInt32 start = Math.Max(segment.addr, sector.addr);
+                UInt32 end = Math.Min(segment.end, sector.addr + sector.size);
+                Buffer.BlockCopy(
+                    segment.data.Array, segment.data.Offset + (int)(start - segment.addr),
+                    merged, (int)(start - sector.addr),
+                    (int)(end - start));
+            }
+            return merged;
+        }
+
+        // 
+        //         Add the pages of the merged sector that need programming
+        // 
+        //         After an erase (unchanged == null) every non-empty page is programmed.
+        //         Without an erase only pages that differ from unchanged are programmed, and
+        //         unchanged words are left empty so the algorithm skips them.
+        //         The merged sector is only built when a page is not a slice of the image.
+        // 
+        private void _add_pages(SectorPlan sector_plan, int first, byte[] unchanged, Func<byte[]> merge)
+        {
+            FlashDevice.Sector sector = sector_plan.sector;
+            int page_size = (int)Math.Min(this.device.sz_page, sector.size);
+            byte[] merged = unchanged != null ? merge() : null;
+            for (int offset = 0; offset < sector.size; offset += page_size)
+            {
+                UInt32 page_addr = sector.addr + (UInt32)offset;
+                if (unchanged != null)
+                {
+                    if (_same(merged, offset, unchanged, offset, page_size))
+                    {
+                        continue;
+                    }
+                    byte[] page = new byte[page_size];
+                    for (int i = 0; i < page_size; i += 4)
+                    {
+                        bool changed = !_same(merged, offset + i, unchanged, offset + i, 4);
+                        for (int j = i; j < i + 4; j++)
+                        {
+                            page[j] = changed ? merged[offset + j] : this.device.val_empty;
+                        }
+                    }
+                    sector_plan.pages.Add(new PagePlan(page_addr, new ArraySegment<byte>(page)));
+                    continue;
+                }
+                ArraySegment<byte> page_data;
+                ArraySegment<byte>? slice = this._slice(page_addr, (UInt32)page_size, first);
+                if (slice != null)
+                {
+                    page_data = (ArraySegment<byte>)slice;
+                }
+                else
+                {
+                    merged = merged ?? merge();
+                    page_data = new ArraySegment<byte>(merged, offset, page_size);
+                }
+                if (_erased(page_data.Array, page_data.Offset, page_size, this.device.val_empty))
+                {
+                    continue;
+                }
+                sector_plan.pages.Add(new PagePlan(page_addr, page_data));
+            }
+        }
+
+        // Slice of the image if a single segment holds the whole range
+        private ArraySegment<byte>? _slice(UInt32 addr, UInt32 size, int first)
+        {
+            for (int i = first; i < this.segments.Count && this.segments[i].addr <= addr; i++)
+            {
+                Segment segment = this.segments[i];
+                if (segment.end >= addr + size)
+                {
+                    return new ArraySegment<byte>(segment.data.Array, segment.data.Offset + (int)(addr - segment.addr), (int)size);
+                }
+            }
+            return null;
+        }
+
+        // 
+        //         Compare two ranges a SIMD register at a time
+        // 
+        public static bool _same(byte[] a, int a_offset, byte[] b, int b_offset, int count)
+        {
+            int i = 0;
+            for (; i + Vector<byte>.Count <= count; i += Vector<byte>.Count)
+            {
+                if (new Vector<byte>(a, a_offset + i) != new Vector<byte>(b, b_offset + i))
+                {
+                    return false;
+                }
+            }
+            for (; i < count; i++)
+            {
+                if (a[a_offset + i] != b[b_offset + i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        public static bool _erased(byte[] a, int offset, int count, byte val_empty)
+        {
+            Vector<byte> empty = new Vector<byte>(val_empty);
+            int i = 0;
+            for (; i + Vector<byte>.Count <= count; i += Vector<byte>.Count)
+            {
+                if (new Vector<byte>(a, offset + i) != empty)
+                {
+                    return false;
+                }
+            }
+            for (; i < count; i++)
+            {
+                if (a[offset + i] != val_empty)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        private static void _fill(byte[] a, int offset, int count, byte value)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                a[offset + i] = value;
+            }
+        }
+
+        // 
+        //         Estimated time of a plan in seconds
+        // 
+        //         erase_weight gives the erase time of a sector from its size.
+        // 
+        public static double getWeight(List<SectorPlan> plans, Func<UInt32, double> erase_weight, double program_weight)
+        {
+            double weight = 0;
+            foreach (SectorPlan sector_plan in plans)
+            {
+                if (sector_plan.action == SectorAction.ERASE_PROGRAM)
+                {
+                    weight += erase_weight(sector_plan.sector.size);
+                }
+                foreach (PagePlan page in sector_plan.pages)
+                {
+                    weight += program_weight + (float)(page.data.Count) / (float)(FlashBuilderConsts.DATA_TRANSFER_B_PER_S);
+                }
+            }
+            return weight;
+        }
+    }
+}
@@ -249,7 +249,9 @@ namespace openocd.CmsisDap
                 List<byte> l = new List<byte>();
                 Stopwatch sw = new Stopwatch();
                 sw.Start();
-                l.AddRange(w.readBlockMemoryUnaligned8(0x00000000, (UInt32)bytes.Length));
+                // Read back through the core's debug context, so later reads of the image come from its memory cache
+                Debugger.CachingDebugContext context = (Debugger.CachingDebugContext)w.getTargetContext();
+                l.AddRange(context.readBlockMemoryUnaligned8(0x00000000, (UInt32)bytes.Length));
                 //l.AddRange(w.readBlockMemoryUnaligned8(0x08000000, (UInt32)bytes.Length));
                 sw.Stop();
                 Trace.TraceInformation("Reading speed is {0:0.000} kB/s", ((double)bytes.Length / 1024.0) / sw.Elapsed.TotalSeconds);
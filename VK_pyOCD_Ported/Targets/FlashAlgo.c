@@ -0,0 +1,71 @@
+/***********************************************************************/
+/*                                                                     */
+/*  FlashAlgo.c:  Dispatch Header and Entry Point of the Flash         */
+/*                Algorithm Image                                      */
+/*                                                                     */
+/*  Target.lin places FlashAlgoHeader at offset 0 of the image and     */
+/*  FlashAlgoStats at the static base.                                 */
+/*                                                                     */
+/***********************************************************************/
+
+#include "FlashOS.H"        // FlashOS Structures
+#include "FlashAlgo.h"      // Dispatch Header and RAM Layout
+
+extern int ProgramFill (unsigned long adr, unsigned long sz, unsigned long pat);
+extern int compute_crc (void *data, unsigned int num);      // src/analyzer/main.c
+
+/*
+ *  Dispatch Header, laid out as struct FlashAlgoHeader and followed by
+ *  a branch to Dispatch. Header and branch form one code section that
+ *  Target.lin places +FIRST in PrgCode, so the image keeps the standard
+ *  PrgCode / PrgData / DevDscr layout. The branch is PC relative, which
+ *  keeps the image position independent.
+ */
+
+#pragma arm section code = "FlashAlgoHeader"
+
+__asm void FlashAlgoHeader (void) {
+        DCD     0x4770BE00                      ; BKPT #0, BX LR
+        DCD     ALGO_MAGIC
+        DCD     ALGO_VERSION
+        DCD     __cpp(sizeof(struct FlashAlgoHeader))
+        DCD     __cpp(ALGO_CAP_ERASE_CHIP   | ALGO_CAP_ERASE_SECTOR | ALGO_CAP_PROGRAM_PAGE |
+                      ALGO_CAP_PROGRAM_FILL | ALGO_CAP_COMPUTE_CRC  | ALGO_CAP_STATS        |
+                      ALGO_CAP_PARTIAL_PAGE)
+        DCD     __cpp(sizeof(struct FlashAlgoHeader))   ; Dispatch entry follows the header
+        DCD     ALGO_RW_OFFSET
+        DCD     ALGO_STACK_OFFSET
+        DCD     ALGO_DATA_OFFSET
+        DCD     ALGO_DATA_SIZE
+        DCD     ALGO_RAM_SIZE
+        B.W     __cpp(Dispatch)                 ; r0..r3 are passed on unchanged
+}
+
+#pragma arm section code
+
+__attribute__((section("FlashAlgoStats")))
+struct FlashAlgoStats FlashAlgoStats  =  {
+   ALGO_STATS_VERSION,
+};
+
+
+/*
+ *  Single Entry Point of the Image
+ *    Parameter:      a0..a2:  Arguments of the operation
+ *                    op:      Operation Code (ALGO_OP_*)
+ *    Return Value:   Return Value of the operation, 1 - Unknown operation
+ */
+
+int Dispatch (unsigned long a0, unsigned long a1, unsigned long a2, unsigned long op) {
+
+  switch (op) {
+    case ALGO_OP_INIT:          return (Init(a0, a1, a2));
+    case ALGO_OP_UNINIT:        return (UnInit(a0));
+    case ALGO_OP_ERASE_CHIP:    return (EraseChip());
+    case ALGO_OP_ERASE_SECTOR:  return (EraseSector(a0));
+    case ALGO_OP_PROGRAM_PAGE:  return (ProgramPage(a0, a1, (unsigned char *)a2));
+    case ALGO_OP_PROGRAM_FILL:  return (ProgramFill(a0, a1, a2));
+    case ALGO_OP_COMPUTE_CRC:   return (compute_crc((void *)a0, a1));
+  }
+  return (1);                                           // Unknown operation
+}
@@ -0,0 +1,94 @@
+/***********************************************************************/
+/*                                                                     */
+/*  FlashAlgo.h:  Dispatch Header and RAM Layout of the Flash          */
+/*                Algorithm Image                                      */
+/*                                                                     */
+/*  The image (FlashAlgo.c + FlashPrg.c + FlashDev.c + CRC analyzer)   */
+/*  is position independent. All offsets are relative to the address  */
+/*  the host loads the image to. The host reads the header from the    */
+/*  start of the image, so no entry point addresses are hard-coded     */
+/*  on the host side and one upload serves all operations.             */
+/*                                                                     */
+/*  Also included by Target.lin, keep the layout part plain #defines.  */
+/*                                                                     */
+/***********************************************************************/
+
+#ifndef FLASH_ALGO_H
+#define FLASH_ALGO_H
+
+// RAM Layout (offsets from the load address)
+#define ALGO_RW_OFFSET          0x00000800      // RW/ZI data, static base (r9)
+#define ALGO_STACK_OFFSET       0x00001400      // Initial stack pointer (grows down)
+#define ALGO_DATA_OFFSET        0x00001400      // Page / CRC buffer
+#define ALGO_DATA_SIZE          0x00002000      // 8kB: 1MB of 512 Byte pages for CRC
+#define ALGO_RAM_SIZE           (ALGO_DATA_OFFSET + ALGO_DATA_SIZE)
+
+#ifndef ALGO_LAYOUT_ONLY
+
+#define ALGO_MAGIC              0x4F474C41      // "ALGO"
+#define ALGO_VERSION            1               // Header layout version
+
+// Operation Codes (passed in r3 to Dispatch)
+#define ALGO_OP_INIT            0               // Init (adr, clk, fnc)
+#define ALGO_OP_UNINIT          1               // UnInit (fnc)
+#define ALGO_OP_ERASE_CHIP      2               // EraseChip ()
+#define ALGO_OP_ERASE_SECTOR    3               // EraseSector (adr)
+#define ALGO_OP_PROGRAM_PAGE    4               // ProgramPage (adr, sz, buf)
+#define ALGO_OP_PROGRAM_FILL    5               // ProgramFill (adr, sz, pat)
+#define ALGO_OP_COMPUTE_CRC     6               // compute_crc (data, num), used to verify
+
+// Capability Bits
+#define ALGO_CAP_ERASE_CHIP     0x00000001
+#define ALGO_CAP_ERASE_SECTOR   0x00000002
+#define ALGO_CAP_PROGRAM_PAGE   0x00000004
+#define ALGO_CAP_PROGRAM_FILL   0x00000008
+#define ALGO_CAP_COMPUTE_CRC    0x00000010
+#define ALGO_CAP_STATS          0x00000020      // FlashAlgoStats at the static base
+#define ALGO_CAP_PARTIAL_PAGE   0x00000040      // ProgramPage skips erased words
+
+#define ALGO_STATS_VERSION      1               // Stats layout version
+
+// Dispatch Header, first thing in the image
+struct FlashAlgoHeader {
+  unsigned long trap;           // BKPT #0, BX LR: return address of every call
+  unsigned long magic;          // ALGO_MAGIC
+  unsigned long version;        // ALGO_VERSION
+  unsigned long size;           // Size of this header
+  unsigned long caps;           // ALGO_CAP_* bits
+  unsigned long dispatch;       // Offset of the branch to Dispatch
+  unsigned long static_base;    // Offset of RW/ZI data
+  unsigned long stack;          // Offset of initial stack pointer
+  unsigned long data;           // Offset of data buffer
+  unsigned long data_size;      // Size of data buffer
+  unsigned long ram_size;       // RAM needed from the load address
+};
+
+// Counters of one operation type, all words so the host can read them as such
+struct FlashOpStats {
+  unsigned long calls;          // Number of calls
+  unsigned long errors;         // Number of failed calls
+  unsigned long polls;          // BSY poll iterations
+  unsigned long bytes;          // Bytes programmed
+  unsigned long cycles_max;     // Longest call in DWT cycles
+  unsigned long cycles_lo;      // Total DWT cycles, low word
+  unsigned long cycles_hi;      // Total DWT cycles, high word
+};
+
+// Performance Counters, first thing in RW data. The host reads and
+// clears the counters after each batch of operations.
+struct FlashAlgoStats {
+  unsigned long version;        // ALGO_STATS_VERSION
+  unsigned long reserved;
+  struct FlashOpStats erase_chip;
+  struct FlashOpStats erase_sector;
+  struct FlashOpStats program_page;
+  struct FlashOpStats program_fill;
+};
+
+extern struct FlashAlgoStats FlashAlgoStats;
+
+extern int Dispatch (unsigned long a0, unsigned long a1, unsigned long a2, unsigned long op);
+
+#endif // ALGO_LAYOUT_ONLY
+
+#endif // FLASH_ALGO_H
@@ -10,6 +10,7 @@
 /***********************************************************************/
 
 #include "FlashOS.H"        // FlashOS Structures
+#include "FlashAlgo.h"      // Performance Counters
 
 typedef volatile unsigned char    vu8;
 typedef          unsigned char     u8;
@@ -25,9 +26,12 @@ typedef          unsigned long     u32;
 // Peripheral Memory Map
 #define IWDG_BASE         0x40003000
 #define FLASH_BASE        0x40023C00
+#define DWT_BASE          0xE0001000
+#define DEMCR             M32(0xE000EDFC)
 
 #define IWDG            ((IWDG_TypeDef *) IWDG_BASE)
 #define FLASH           ((FLASH_TypeDef*) FLASH_BASE)
+#define DWT             ((DWT_TypeDef  *) DWT_BASE)
 
 // Independent WATCHDOG
 typedef struct {
@@ -37,6 +41,14 @@ typedef struct {
   vu32 SR;
 } IWDG_TypeDef;
 
+// Data Watchpoint and Trace
+typedef struct {
+  vu32 CTRL;
+  vu32 CYCCNT;
+  vu32 RESERVED[1002];
+  vu32 LAR;                                             // Offset 0xFB0
+} DWT_TypeDef;
+
 // Flash Registers
 typedef struct {
   vu32 ACR;
@@ -90,6 +102,11 @@ typedef struct {
 
 #define FLASH_PGERR             (FLASH_PGSERR | FLASH_PGPERR | FLASH_PGAERR | FLASH_WRPERR)
 
+// Cycle Counter definitions
+#define DEMCR_TRCENA            ((unsigned int)0x01000000)
+#define DWT_CYCCNTENA           ((unsigned int)0x00000001)
+#define DWT_LAR_KEY             0xC5ACCE55
+
 void BKPT(void) {
     __asm("BKPT #0");
 }
@@ -99,6 +116,40 @@ void DSB(void) {
 }
 
 
+/*
+ *  Performance Counters of the running operation
+ *    Polls counts BSY poll iterations, StatsEnd adds them and the
+ *    elapsed DWT cycles to the counters of the operation.
+ */
+static u32 Polls;
+static u32 Cycles;
+
+static void StatsBegin (void) {
+  Polls  = 0;
+  Cycles = DWT->CYCCNT;
+}
+
+static int StatsEnd (struct FlashOpStats *op, unsigned long sz, int result) {
+  u32 n;
+
+  n = DWT->CYCCNT - Cycles;                             // Elapsed Cycles
+  op->calls++;
+  op->polls += Polls;
+  op->bytes += sz;
+  if (n > op->cycles_max) {
+    op->cycles_max = n;
+  }
+  op->cycles_lo += n;
+  if (op->cycles_lo < n) {                              // Carry
+    op->cycles_hi++;
+  }
+  if (result) {
+    op->errors++;
+  }
+  return (result);
+}
+
+
 /*
  * Get Sector Number
  *    Parameter:      adr:  Sector Address
@@ -211,6 +262,10 @@ int Init (unsigned long adr, unsigned long clk, unsigned long fnc) {
   FLASH->ACR  = 0x00000000;                             // Zero Wait State, no Cache, no Prefetch
   FLASH->SR  |= FLASH_PGERR;                            // Reset Error Flags
 
+  DEMCR      |= DEMCR_TRCENA;                           // Enable Cycle Counter
+  DWT->LAR    = DWT_LAR_KEY;
+  DWT->CTRL  |= DWT_CYCCNTENA;
+
   if ((FLASH->OPTCR & 0x20) == 0x00) {                  // Test if IWDG is running (IWDG in HW mode)
     // Set IWDG time out to ~32.768 second
     IWDG->KR  = 0x5555;                                 // Enable write access to IWDG_PR and IWDG_RLR     
@@ -241,6 +296,8 @@ int UnInit (unsigned long fnc) {
  */
 
 int EraseChip (void) {
+  StatsBegin();
+  FLASH->SR |= FLASH_PGERR;                             // Reset Error Flags
 	FLASH->CR |=  FLASH_MER; 
 	
 	#if defined(STM32F7x_2048dual) || defined(STM32F7xTCM_2048dual)
@@ -250,12 +307,16 @@ int EraseChip (void) {
 
   while (FLASH->SR & FLASH_BSY) {
     IWDG->KR = 0xAAAA;                                  // Reload IWDG
+    Polls++;
   }
 
   FLASH->CR &= ~FLASH_MER;                              // Mass Erase Disabled
 
-
-  return (0);                                           // Done
+  if (FLASH->SR & FLASH_PGERR) {                        // Check for Error
+    FLASH->SR |= FLASH_PGERR;                           // Reset Error Flags
+    return (StatsEnd(&FlashAlgoStats.erase_chip, 0, 1));  // Failed
+  }
+  return (StatsEnd(&FlashAlgoStats.erase_chip, 0, 0));  // Done
 }
 
 /*
@@ -269,6 +330,7 @@ int EraseSector (unsigned long adr) {
   unsigned long n;
 
   n = GetSecNum(adr);                                   // Get Sector Number
+  StatsBegin();
   FLASH->SR |= FLASH_PGERR;                             // Reset Error Flags
 
   FLASH->CR  =  FLASH_SER;                              // Sector Erase Enabled 
@@ -277,15 +339,16 @@ int EraseSector (unsigned long adr) {
 
   while (FLASH->SR & FLASH_BSY) {
     IWDG->KR = 0xAAAA;                                  // Reload IWDG
+    Polls++;
   }
 
   FLASH->CR &= ~FLASH_SER;                              // Page Erase Disabled 
 
   if (FLASH->SR & FLASH_PGERR) {                        // Check for Error
     FLASH->SR |= FLASH_PGERR;                           // Reset Error Flags
-    return (1);                                         // Failed
+    return (StatsEnd(&FlashAlgoStats.erase_sector, 0, 1));  // Failed
   }
-  return (0);                                           // Done
+  return (StatsEnd(&FlashAlgoStats.erase_sector, 0, 0));    // Done
 }
 #endif // FLASH_MEM
 
@@ -295,6 +358,7 @@ int EraseSector (unsigned long adr) {
   unsigned long n;
 
   n = GetSecNum(0x08000000+(adr-0x00200000));           // Get Sector Number
+  StatsBegin();
   FLASH->SR |= FLASH_PGERR;                             // Reset Error Flags
 
   FLASH->CR  =  FLASH_SER;                              // Sector Erase Enabled 
@@ -303,92 +367,132 @@ int EraseSector (unsigned long adr) {
 
   while (FLASH->SR & FLASH_BSY) {
     IWDG->KR = 0xAAAA;                                  // Reload IWDG
+    Polls++;
   }
 
   FLASH->CR &= ~FLASH_SER;                              // Page Erase Disabled 
 
   if (FLASH->SR & FLASH_PGERR) {                        // Check for Error
     FLASH->SR |= FLASH_PGERR;                           // Reset Error Flags
-    return (1);                                         // Failed
+    return (StatsEnd(&FlashAlgoStats.erase_sector, 0, 1));  // Failed
   }
-  return (0);                                           // Done
+  return (StatsEnd(&FlashAlgoStats.erase_sector, 0, 0));    // Done
 }
 #endif // FLASH_TCM
 
 /*
- *  Program Page in Flash Memory
- *    Parameter:      adr:  Page Start Address
- *                    sz:   Page Size
- *                    buf:  Page Data
+ *  Program Word in Flash Memory
+ *    Parameter:      adr:  Word Address (Flash Memory Interface)
+ *                    val:  Word Data
  *    Return Value:   0 - OK,  1 - Failed
  */
 #ifdef FLASH_MEM
-int ProgramPage (unsigned long adr, unsigned long sz, unsigned char *buf) {	
+static int ProgramWord (unsigned long adr, u32 val) {
 
-  sz = (sz + 3) & ~3;                                   // Adjust size for Words
-  FLASH->SR |= FLASH_PGERR;                             // Reset Error Flags
-  FLASH->CR  =  0;                                      // reset CR 
+  FLASH->CR |= (FLASH_PG              |                 // Programming Enabled
+                FLASH_PSIZE_Word);                      // Programming Enabled (Word)
+  FLASH->OPTCR |= 0x00FF0000;                           // Allow writes to all sectors
 
-  while (sz) {
+  M32(0x08000000 + adr) = val;                          // Program Word
+  DSB();
+  while (FLASH->SR & FLASH_BSY){
+    IWDG->KR = 0xAAAA;                                  // Reload IWDG
+    Polls++;
+  }
 
-    FLASH->CR |= (FLASH_PG              |               // Programming Enabled
-                  FLASH_PSIZE_Word);                    // Programming Enabled (Word)
-		FLASH->OPTCR |= 0x00FF0000;                         // Allow writes to all sectors
+  FLASH->CR &= ~FLASH_PG;                               // Programming Disabled
 
-    M32(0x08000000 + adr) = *((u32 *)buf);                           // Program Double Word
-    DSB();
-    while (FLASH->SR & FLASH_BSY){
-      IWDG->KR = 0xAAAA;                                // Reload IWDG
-    }
+  if (FLASH->SR & FLASH_PGERR) {                        // Check for Error
+    FLASH->SR |= FLASH_PGERR;                           // Reset Error Flags
+    return (1);                                         // Failed
+  }
+  return (0);                                           // Done
+}
+#endif // FLASH_MEM
 
-    FLASH->CR &= ~FLASH_PG;                             // Programming Disabled
 
-    if (FLASH->SR & FLASH_PGERR) {                      // Check for Error
-      FLASH->SR |= FLASH_PGERR;                         // Reset Error Flags
-      return (1);                                       // Failed
-    }
+#if defined(FLASH_TCM) || defined(STM32F7xTCM_2048) || defined(STM32F7xTCM_2048dual)
+static int ProgramWord (unsigned long adr, u32 val) {
 
-    adr += 4;                                           // Go to next Word
-    buf += 4;
-    sz  -= 4;
+  FLASH->CR |= (FLASH_PG              |                 // Programming Enabled
+                FLASH_PSIZE_Word);                      // Programming Enabled (Word)
+
+  M32(0x08000000+(adr-0x200000)) = val;                 // Program Word
+  DSB();
+  while (FLASH->SR & FLASH_BSY){
+    IWDG->KR = 0xAAAA;                                  // Reload IWDG
+    Polls++;
   }
 
+  FLASH->CR &= ~FLASH_PG;                               // Programming Disabled
+
+  if (FLASH->SR & FLASH_PGERR) {                        // Check for Error
+    FLASH->SR |= FLASH_PGERR;                           // Reset Error Flags
+    return (1);                                         // Failed
+  }
   return (0);                                           // Done
 }
-#endif // FLASH_MEM
+#endif // FLASH_TCM
 
+/*
+ *  Program Page in Flash Memory
+ *    Parameter:      adr:  Page Start Address
+ *                    sz:   Page Size
+ *                    buf:  Page Data
+ *    Return Value:   0 - OK,  1 - Failed
+ *
+ *  The page has been erased before, so words equal to the erased
+ *  value (0xFFFFFFFF) are skipped instead of programmed.
+ */
 
-#if defined(FLASH_TCM) || defined(STM32F7xTCM_2048) || defined(STM32F7xTCM_2048dual)
-int ProgramPage (unsigned long adr, unsigned long sz, unsigned char *buf) {	
+int ProgramPage (unsigned long adr, unsigned long sz, unsigned char *buf) {
+  unsigned long n, done;
+  u32 val;
 
+  StatsBegin();
   sz = (sz + 3) & ~3;                                   // Adjust size for Words
   FLASH->SR |= FLASH_PGERR;                             // Reset Error Flags
   FLASH->CR  =  0;                                      // reset CR 
 
-  while (sz) {
+  done = 0;                                             // Bytes actually programmed
+  for (n = 0; n < sz; n += 4) {
+    val = *((u32 *)(buf + n));
+    if (val != 0xFFFFFFFF) {                            // Erased Word needs no Programming
+      if (ProgramWord(adr + n, val)) {
+        return (StatsEnd(&FlashAlgoStats.program_page, done, 1));  // Failed
+      }
+      done += 4;
+    }
+  }
 
-    FLASH->CR |= (FLASH_PG              |               // Programming Enabled
-                  FLASH_PSIZE_Word);                    // Programming Enabled (Word)
+  return (StatsEnd(&FlashAlgoStats.program_page, done, 0));     // Done
+}
 
-    M32(0x08000000+(adr-0x200000)) = *((u32 *)buf);     // Program Double Word
-    DSB();
-    while (FLASH->SR & FLASH_BSY){
-      IWDG->KR = 0xAAAA;                                // Reload IWDG
-    }
+/*
+ *  Program Erased Flash Memory with a constant Pattern
+ *    Parameter:      adr:  Start Address
+ *                    sz:   Size in Bytes
+ *                    pat:  Word Pattern
+ *    Return Value:   0 - OK,  1 - Failed
+ */
 
-  //  for(;i<1000;i++);
-    FLASH->CR &= ~FLASH_PG;                             // Programming Disabled
+int ProgramFill (unsigned long adr, unsigned long sz, unsigned long pat) {
+  unsigned long n;
 
-    if (FLASH->SR & FLASH_PGERR) {                      // Check for Error
-      FLASH->SR |= FLASH_PGERR;                         // Reset Error Flags
-      return (1);                                       // Failed
-    }
+  if (pat == 0xFFFFFFFF) {                              // Already erased
+    return (0);
+  }
 
-    adr += 4;                                           // Go to next Word
-    buf += 4;
-    sz  -= 4;
+  StatsBegin();
+  sz = (sz + 3) & ~3;                                   // Adjust size for Words
+  FLASH->SR |= FLASH_PGERR;                             // Reset Error Flags
+  FLASH->CR  =  0;                                      // reset CR 
+
+  for (n = 0; n < sz; n += 4) {
+    if (ProgramWord(adr + n, pat)) {
+      return (StatsEnd(&FlashAlgoStats.program_fill, n, 1));    // Failed
+    }
   }
 
-  return (0);                                           // Done
+  return (StatsEnd(&FlashAlgoStats.program_fill, sz, 0));      // Done
 }
-#endif // FLASH_TCM